@@ -0,0 +1,86 @@
+#include "compositor/animation.h"
+
+struct anim_entry {
+    int active;
+    uint64_t start;
+    struct render_rect from;
+    struct render_rect to;
+};
+
+static struct anim_entry g_anims[DEIMOS_ANIM_MAX_IDS];
+static int g_duration_us = 0;
+
+static int rect_equal(const struct render_rect *a, const struct render_rect *b) {
+    return a->x == b->x && a->y == b->y && a->w == b->w && a->h == b->h;
+}
+
+static int lerp(int a, int b, int t) {
+    return a + (int)(((int64_t)(b - a) * t) >> 16);
+}
+
+void deimos_anim_set_duration(int duration_us) {
+    if (duration_us < 0) duration_us = 0;
+    g_duration_us = duration_us;
+}
+
+int deimos_anim_duration(void) {
+    return g_duration_us;
+}
+
+int deimos_anim_ease_out(int t) {
+    if (t <= 0) return 0;
+    if (t >= DEIMOS_ANIM_ONE) return DEIMOS_ANIM_ONE;
+
+    // 1 - (1 - t)^3
+    int64_t inv = DEIMOS_ANIM_ONE - t;
+    int64_t cube = (((inv * inv) >> 16) * inv) >> 16;
+    return DEIMOS_ANIM_ONE - (int)cube;
+}
+
+int deimos_anim_start(int window_id, const struct render_rect *from, const struct render_rect *to, uint64_t now) {
+    if (window_id <= 0 || window_id >= DEIMOS_ANIM_MAX_IDS) return 0;
+
+    struct anim_entry *a = &g_anims[window_id];
+    if (g_duration_us <= 0 || !from || !to || rect_equal(from, to)) {
+        a->active = 0;
+        return 0;
+    }
+
+    a->from = *from;
+    a->to = *to;
+    a->start = now;
+    a->active = 1;
+    return 1;
+}
+
+void deimos_anim_cancel(int window_id) {
+    if (window_id <= 0 || window_id >= DEIMOS_ANIM_MAX_IDS) return;
+    g_anims[window_id].active = 0;
+}
+
+int deimos_anim_active(int window_id) {
+    if (window_id <= 0 || window_id >= DEIMOS_ANIM_MAX_IDS) return 0;
+    return g_anims[window_id].active;
+}
+
+int deimos_anim_sample(int window_id, uint64_t now, struct render_rect *out) {
+    if (window_id <= 0 || window_id >= DEIMOS_ANIM_MAX_IDS) return 0;
+
+    struct anim_entry *a = &g_anims[window_id];
+    if (!a->active) return 0;
+
+    uint64_t elapsed = now - a->start;
+    if (g_duration_us <= 0 || elapsed >= (uint64_t)g_duration_us) {
+        *out = a->to;
+        a->active = 0;
+        return 0;
+    }
+
+    int t = (int)((elapsed << 16) / (uint64_t)g_duration_us);
+    int e = deimos_anim_ease_out(t);
+    out->x = lerp(a->from.x, a->to.x, e);
+    out->y = lerp(a->from.y, a->to.y, e);
+    out->w = lerp(a->from.w, a->to.w, e);
+    out->h = lerp(a->from.h, a->to.h, e);
+    return 1;
+}
@@ -0,0 +1,28 @@
+#ifndef DEIMOS_COMPOSITOR_ANIMATION_H
+#define DEIMOS_COMPOSITOR_ANIMATION_H
+
+#include <stdint.h>
+#include "rendering/rendering.h"
+
+// Rect transitions keyed by window id, sampled against the microsecond frame
+// clock (deimos_gov_clock_us). Interpolation is 16.16 fixed point with an
+// ease-out cubic curve.
+#define DEIMOS_ANIM_MAX_IDS 32
+#define DEIMOS_ANIM_ONE 65536
+
+void deimos_anim_set_duration(int duration_us); // 0 disables animation
+int deimos_anim_duration(void);
+
+// Starts (or retargets) the transition for window_id. Returns 0 when
+// animation is disabled or from == to, in which case the caller should snap.
+int deimos_anim_start(int window_id, const struct render_rect *from, const struct render_rect *to, uint64_t now);
+void deimos_anim_cancel(int window_id);
+int deimos_anim_active(int window_id);
+
+// Writes the rect for `now`. Returns 1 while still running, 0 once the
+// transition has finished (out then holds the target) or none exists.
+int deimos_anim_sample(int window_id, uint64_t now, struct render_rect *out);
+
+int deimos_anim_ease_out(int t); // t and result in [0, DEIMOS_ANIM_ONE]
+
+#endif
@@ -0,0 +1,282 @@
+#include "compositor/client.h"
+#include "compositor/snapshot.h"
+#include "rendering/convert.h"
+#include "rendering/rendering.h"
+#include "window_manager/state.h"
+
+// PHOBOS has no shared-memory syscall yet, so clients live in-process and the
+// "shared" buffers are carved from one static pool, first fit between the
+// live ones; buffer ids index the table, not the pool.
+struct client_window {
+    int owner; // client id, 0 = unowned
+    int buffer;
+    int pending_buffer; // -1 = no attach pending, 0 = detach
+    struct render_rect damage[DEIMOS_CLIENT_MAX_DAMAGE];
+    int damage_count;
+    int damage_full;
+};
+
+static uint8_t g_pool[DEIMOS_CLIENT_POOL_BYTES] __attribute__((aligned(64)));
+static struct deimos_client_buffer g_buffers[DEIMOS_CLIENT_MAX_BUFFERS + 1];
+static struct client_window g_windows[DEIMOS_MAX_WORKSPACES][DEIMOS_MAX_REPORT_WINDOWS + 1];
+static int g_connected[DEIMOS_CLIENT_MAX + 1];
+
+static int valid_client(int client) {
+    return client > 0 && client <= DEIMOS_CLIENT_MAX && g_connected[client];
+}
+
+static struct deimos_client_buffer *owned_buffer(int client, int buffer) {
+    if (buffer <= 0 || buffer > DEIMOS_CLIENT_MAX_BUFFERS) return 0;
+    if (!valid_client(client) || g_buffers[buffer].owner != client) return 0;
+    return &g_buffers[buffer];
+}
+
+static struct client_window *owned_window(int client, int workspace, int window_id) {
+    if (workspace < 0 || workspace >= DEIMOS_MAX_WORKSPACES) return 0;
+    if (window_id <= 0 || window_id > DEIMOS_MAX_REPORT_WINDOWS) return 0;
+    if (!valid_client(client)) return 0;
+    struct client_window *win = &g_windows[workspace][window_id];
+    if (win->owner != 0 && win->owner != client) return 0;
+    return win;
+}
+
+static void clear_pending(struct client_window *win) {
+    win->pending_buffer = -1;
+    win->damage_count = 0;
+    win->damage_full = 0;
+}
+
+// Buffer texel columns [b0, b1) scaled into `len` screen pixels with the same
+// nearest sampling the draw stage uses: pixel i shows texel (i * size) / len.
+static void map_span(int b0, int b1, int size, int len, int *out0, int *out1) {
+    *out0 = (b0 * len + size - 1) / size;
+    *out1 = (b1 * len + size - 1) / size;
+}
+
+// Buffer-space damage to screen damage inside the window's border. Windows
+// that are not on screen need nothing: they are painted in full when shown,
+// but a snapshot of their workspace would show the old content.
+static void mark_window_damage(int workspace, int window_id, const struct deimos_client_buffer *b,
+                               const struct client_window *win) {
+    if (workspace != deimos_wm_workspace()) {
+        deimos_snapshot_drop(workspace);
+        return;
+    }
+    const struct deimos_window_rect *r = deimos_layout_find(window_id);
+    if (!r || !r->valid) return;
+
+    int bw = deimos_layout_border();
+    int inner_x = r->x + bw;
+    int inner_y = r->y + bw;
+    int inner_w = r->w - 2 * bw;
+    int inner_h = r->h - 2 * bw;
+    if (inner_w <= 0 || inner_h <= 0) return;
+
+    if (!b || win->damage_full) {
+        render_mark_dirty_rect(inner_x, inner_y, inner_w, inner_h);
+        return;
+    }
+
+    for (int i = 0; i < win->damage_count; i++) {
+        const struct render_rect *d = &win->damage[i];
+        int x0, x1, y0, y1;
+        map_span(d->x, d->x + d->w, b->width, inner_w, &x0, &x1);
+        map_span(d->y, d->y + d->h, b->height, inner_h, &y0, &y1);
+        if (x1 > x0 && y1 > y0) {
+            render_mark_dirty_rect(inner_x + x0, inner_y + y0, x1 - x0, y1 - y0);
+        }
+    }
+}
+
+static void set_window_buffer(struct client_window *win, int buffer) {
+    if (win->buffer > 0) g_buffers[win->buffer].attached--;
+    win->buffer = buffer;
+    if (buffer > 0) g_buffers[buffer].attached++;
+}
+
+int deimos_client_connect(void) {
+    for (int client = 1; client <= DEIMOS_CLIENT_MAX; client++) {
+        if (!g_connected[client]) {
+            g_connected[client] = 1;
+            return client;
+        }
+    }
+    return -1;
+}
+
+void deimos_client_disconnect(int client) {
+    if (!valid_client(client)) return;
+
+    for (int ws = 0; ws < DEIMOS_MAX_WORKSPACES; ws++) {
+        for (int id = 1; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+            struct client_window *win = &g_windows[ws][id];
+            if (win->owner != client) continue;
+            if (win->buffer > 0) {
+                win->damage_full = 1;
+                mark_window_damage(ws, id, 0, win);
+            }
+            set_window_buffer(win, 0);
+            clear_pending(win);
+            win->owner = 0;
+        }
+    }
+    for (int buffer = 1; buffer <= DEIMOS_CLIENT_MAX_BUFFERS; buffer++) {
+        if (g_buffers[buffer].owner == client) g_buffers[buffer].owner = 0;
+    }
+    g_connected[client] = 0;
+}
+
+static uint32_t pool_bytes(const struct deimos_client_buffer *b) {
+    return ((uint32_t)b->stride * (uint32_t)b->height + 63U) & ~63U;
+}
+
+// Lowest pool offset where `size` bytes overlap no live buffer, or -1. The
+// lowest fitting spot is always at the start or right after a live buffer.
+static long pool_find(uint32_t size) {
+    long best = -1;
+    for (int i = 0; i <= DEIMOS_CLIENT_MAX_BUFFERS; i++) {
+        uint32_t start = 0;
+        if (i > 0) {
+            if (g_buffers[i].owner == 0) continue;
+            start = (uint32_t)(g_buffers[i].data - g_pool) + pool_bytes(&g_buffers[i]);
+        }
+        if (size > DEIMOS_CLIENT_POOL_BYTES - start || (best >= 0 && start >= (uint32_t)best)) continue;
+
+        int clear = 1;
+        for (int j = 1; j <= DEIMOS_CLIENT_MAX_BUFFERS && clear; j++) {
+            if (g_buffers[j].owner == 0) continue;
+            uint32_t other = (uint32_t)(g_buffers[j].data - g_pool);
+            clear = start + size <= other || other + pool_bytes(&g_buffers[j]) <= start;
+        }
+        if (clear) best = start;
+    }
+    return best;
+}
+
+int deimos_client_buffer_create(int client, int width, int height, int format) {
+    if (!valid_client(client)) return -1;
+    if (width <= 0 || height <= 0) return -1;
+
+    int bytes = render_format_bytes(format);
+    if (bytes <= 0) return -1;
+    if ((uint32_t)width * (uint32_t)height > DEIMOS_CLIENT_POOL_BYTES / (uint32_t)bytes) return -1;
+    uint32_t size = ((uint32_t)width * (uint32_t)height * (uint32_t)bytes + 63U) & ~63U;
+
+    for (int buffer = 1; buffer <= DEIMOS_CLIENT_MAX_BUFFERS; buffer++) {
+        struct deimos_client_buffer *b = &g_buffers[buffer];
+        if (b->owner != 0) continue;
+
+        long offset = pool_find(size);
+        if (offset < 0) return -1;
+
+        b->owner = client;
+        b->width = width;
+        b->height = height;
+        b->format = format;
+        b->bytes_per_pixel = bytes;
+        b->stride = width * bytes;
+        b->attached = 0;
+        b->data = &g_pool[offset];
+        return buffer;
+    }
+    return -1;
+}
+
+void deimos_client_buffer_destroy(int client, int buffer) {
+    struct deimos_client_buffer *b = owned_buffer(client, buffer);
+    if (!b) return;
+
+    // Windows still showing it lose their content.
+    for (int ws = 0; ws < DEIMOS_MAX_WORKSPACES; ws++) {
+        for (int id = 1; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+            struct client_window *win = &g_windows[ws][id];
+            if (win->pending_buffer == buffer) win->pending_buffer = 0;
+            if (win->buffer != buffer) continue;
+            win->damage_full = 1;
+            mark_window_damage(ws, id, 0, win);
+            set_window_buffer(win, 0);
+            clear_pending(win);
+        }
+    }
+    b->owner = 0;
+}
+
+uint8_t *deimos_client_buffer_map(int client, int buffer) {
+    struct deimos_client_buffer *b = owned_buffer(client, buffer);
+    return b ? b->data : 0;
+}
+
+int deimos_client_buffer_busy(int buffer) {
+    if (buffer <= 0 || buffer > DEIMOS_CLIENT_MAX_BUFFERS) return 0;
+    return g_buffers[buffer].attached > 0;
+}
+
+int deimos_client_attach(int client, int workspace, int window_id, int buffer) {
+    struct client_window *win = owned_window(client, workspace, window_id);
+    if (!win) return 0;
+    if (buffer > 0 && !owned_buffer(client, buffer)) return 0;
+
+    win->owner = client;
+    win->pending_buffer = (buffer > 0) ? buffer : 0;
+    return 1;
+}
+
+int deimos_client_damage(int client, int workspace, int window_id, int x, int y, int w, int h) {
+    struct client_window *win = owned_window(client, workspace, window_id);
+    if (!win || win->owner != client) return 0;
+    if (w <= 0 || h <= 0) return 0;
+
+    if (win->damage_count >= DEIMOS_CLIENT_MAX_DAMAGE) {
+        win->damage_full = 1;
+        return 1;
+    }
+    struct render_rect *d = &win->damage[win->damage_count++];
+    d->x = x;
+    d->y = y;
+    d->w = w;
+    d->h = h;
+    return 1;
+}
+
+int deimos_client_commit(int client, int workspace, int window_id) {
+    struct client_window *win = owned_window(client, workspace, window_id);
+    if (!win || win->owner != client) return 0;
+
+    if (win->pending_buffer >= 0 && win->pending_buffer != win->buffer) {
+        // A different buffer may differ in size; repaint the whole window.
+        win->damage_full = 1;
+        set_window_buffer(win, win->pending_buffer);
+    }
+
+    const struct deimos_client_buffer *b = (win->buffer > 0) ? &g_buffers[win->buffer] : 0;
+    int changed = win->damage_full || (b && win->damage_count > 0);
+    if (b) {
+        // Clamp to the buffer so mapping never reaches past the window.
+        for (int i = 0; i < win->damage_count; i++) {
+            struct render_rect *d = &win->damage[i];
+            int x1 = d->x + d->w;
+            int y1 = d->y + d->h;
+            if (d->x < 0) d->x = 0;
+            if (d->y < 0) d->y = 0;
+            if (x1 > b->width) x1 = b->width;
+            if (y1 > b->height) y1 = b->height;
+            d->w = x1 - d->x;
+            d->h = y1 - d->y;
+        }
+    }
+    if (changed) {
+        mark_window_damage(workspace, window_id, b, win);
+    }
+
+    if (win->buffer <= 0) {
+        win->owner = 0; // detached: the window is free to claim again
+    }
+    clear_pending(win);
+    return changed;
+}
+
+const struct deimos_client_buffer *deimos_client_window_buffer(int window_id) {
+    if (window_id <= 0 || window_id > DEIMOS_MAX_REPORT_WINDOWS) return 0;
+    int buffer = g_windows[deimos_wm_workspace()][window_id].buffer;
+    return (buffer > 0) ? &g_buffers[buffer] : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef DEIMOS_COMPOSITOR_CLIENT_H
+#define DEIMOS_COMPOSITOR_CLIENT_H
+
+#include <stdint.h>
+#include "compositor/layout.h"
+
+// Client surface protocol. A client allocates buffers from the compositor's
+// buffer pool, writes pixels into them directly, attaches one to a window (a
+// window id on a given workspace; ids repeat across workspaces) and
+// commits it together with the buffer-space rects it changed. The draw stage
+// samples the committed buffer in place (no copy), and a commit only damages
+// the screen area its rects map to.
+//
+// Attach and damage are pending state; commit applies them atomically. A
+// committed buffer stays busy until another one is committed to its window
+// (or the window is detached), and clients must not write to busy buffers
+// other than through a damage + commit of the same buffer.
+#define DEIMOS_CLIENT_MAX 8
+#define DEIMOS_CLIENT_MAX_BUFFERS 32
+#define DEIMOS_CLIENT_POOL_BYTES (512U * 1024U) // shared by all buffers, sub-allocated
+#define DEIMOS_CLIENT_MAX_DAMAGE 16
+
+struct deimos_client_buffer {
+    int owner;    // client id, 0 = free
+    int width;
+    int height;
+    int format;   // RENDER_FORMAT_*
+    int bytes_per_pixel;
+    int stride;   // bytes per row
+    int attached; // windows currently showing this buffer
+    uint8_t *data;
+};
+
+// Returns a client id (> 0) or -1 when the table is full.
+int deimos_client_connect(void);
+// Detaches the client's windows (damaging them) and frees its buffers.
+void deimos_client_disconnect(int client);
+
+// Returns a buffer id (> 0) or -1 if the size/format is unsupported or the
+// pool is exhausted.
+int deimos_client_buffer_create(int client, int width, int height, int format);
+void deimos_client_buffer_destroy(int client, int buffer);
+uint8_t *deimos_client_buffer_map(int client, int buffer);
+int deimos_client_buffer_busy(int buffer);
+
+// buffer <= 0 detaches on commit. A window belongs to the first client that
+// attaches to it until that client detaches or disconnects.
+int deimos_client_attach(int client, int workspace, int window_id, int buffer);
+// Rect in buffer coordinates. Past DEIMOS_CLIENT_MAX_DAMAGE rects the whole
+// buffer is treated as damaged.
+int deimos_client_damage(int client, int workspace, int window_id, int x, int y, int w, int h);
+// Applies pending state and marks the mapped screen damage; on a workspace
+// that is not shown, its snapshot is dropped instead. Returns 1 if the
+// window's content changed.
+int deimos_client_commit(int client, int workspace, int window_id);
+
+// Committed buffer of a window on the active workspace, or 0.
+const struct deimos_client_buffer *deimos_client_window_buffer(int window_id);
+
+#endif
@@ -0,0 +1,165 @@
+#include "compositor/damage_verify.h"
+#include "util.h"
+
+#define VERIFY_REPORT_RECTS 8
+
+struct verify_event {
+    uint32_t frame;
+    struct user_input_event ev;
+};
+
+static struct verify_event g_events[DEIMOS_VERIFY_EVENTS];
+static uint32_t g_event_count; // total noted; the ring holds the newest
+static struct deimos_verify_stats g_stats;
+
+static int append_colour(char *out, int n, uint32_t c) {
+    static const char digits[] = "0123456789abcdef";
+    n = deimos_append_str(out, n, "#");
+    for (int shift = 20; shift >= 0 && n < DEIMOS_LINE - 2; shift -= 4) {
+        out[n++] = digits[(c >> shift) & 0xF];
+    }
+    return n;
+}
+
+static int append_rect(char *out, int n, const struct render_rect *r) {
+    n = deimos_append_int(out, n, r->x);
+    n = deimos_append_str(out, n, ",");
+    n = deimos_append_int(out, n, r->y);
+    n = deimos_append_str(out, n, " ");
+    n = deimos_append_int(out, n, r->w);
+    n = deimos_append_str(out, n, "x");
+    return deimos_append_int(out, n, r->h);
+}
+
+static void emit(char *line, int n) {
+    line[n++] = '\n';
+    line[n] = '\0';
+    print(line);
+}
+
+void deimos_verify_note_event(uint32_t frame, const struct user_input_event *ev) {
+    if (!ev) return;
+    struct verify_event *slot = &g_events[g_event_count % DEIMOS_VERIFY_EVENTS];
+    slot->frame = frame;
+    slot->ev = *ev;
+    g_event_count++;
+}
+
+void deimos_verify_frame_checked(void) {
+    g_stats.frames_checked++;
+}
+
+static void report_events(void) {
+    uint32_t first = g_event_count > DEIMOS_VERIFY_EVENTS ? g_event_count - DEIMOS_VERIFY_EVENTS : 0;
+    char line[DEIMOS_LINE];
+    for (uint32_t i = first; i < g_event_count; i++) {
+        const struct verify_event *e = &g_events[i % DEIMOS_VERIFY_EVENTS];
+        int n = 0;
+        n = deimos_append_str(line, n, "[deimos]   event frame ");
+        n = deimos_append_u32(line, n, e->frame);
+        if (e->ev.type == INPUT_EVENT_KEYBOARD) {
+            n = deimos_append_str(line, n, " key ");
+            n = deimos_append_u32(line, n, e->ev.key);
+            n = deimos_append_str(line, n, e->ev.pressed ? " down" : " up");
+        } else {
+            n = deimos_append_str(line, n, e->ev.type == INPUT_EVENT_MOUSE_BUTTON ? " button " : " move ");
+            if (e->ev.type == INPUT_EVENT_MOUSE_BUTTON) {
+                n = deimos_append_u32(line, n, e->ev.scancode);
+                n = deimos_append_str(line, n, e->ev.pressed ? " down " : " up ");
+            }
+            n = deimos_append_int(line, n, e->ev.mouse_x);
+            n = deimos_append_str(line, n, ",");
+            n = deimos_append_int(line, n, e->ev.mouse_y);
+        }
+        emit(line, n);
+    }
+}
+
+static void report_damage(int output) {
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos]   damage ");
+    if (render_is_full_dirty()) {
+        n = deimos_append_str(line, n, "full");
+        emit(line, n);
+        return;
+    }
+
+    struct render_rect area;
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+    int count = 0;
+    if (render_output_geometry(output, &area)) {
+        count = render_damage_clip(area.x, area.y, area.w, area.h, rects, RENDER_MAX_DIRTY_RECTS);
+    }
+    n = deimos_append_u32(line, n, (uint32_t)count);
+    n = deimos_append_str(line, n, " rects");
+    emit(line, n);
+    for (int i = 0; i < count && i < VERIFY_REPORT_RECTS; i++) {
+        n = 0;
+        n = deimos_append_str(line, n, "[deimos]     ");
+        n = append_rect(line, n, &rects[i]);
+        emit(line, n);
+    }
+    if (count > VERIFY_REPORT_RECTS) {
+        n = 0;
+        n = deimos_append_str(line, n, "[deimos]     ... ");
+        n = deimos_append_u32(line, n, (uint32_t)(count - VERIFY_REPORT_RECTS));
+        n = deimos_append_str(line, n, " more");
+        emit(line, n);
+    }
+}
+
+void deimos_verify_report(uint32_t frame, int output, const struct render_verify_result *r) {
+    if (!r || r->mismatches == 0) return;
+    g_stats.frames_mismatched++;
+    g_stats.pixels_mismatched += r->mismatches;
+    if (g_stats.frames_mismatched > DEIMOS_VERIFY_MAX_REPORTS) return;
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] damage verify: output ");
+    n = deimos_append_int(line, n, output);
+    n = deimos_append_str(line, n, " frame ");
+    n = deimos_append_u32(line, n, frame);
+    n = deimos_append_str(line, n, ": ");
+    n = deimos_append_u32(line, n, r->mismatches);
+    n = deimos_append_str(line, n, " px differ in ");
+    n = append_rect(line, n, &r->bounds);
+    emit(line, n);
+
+    n = 0;
+    n = deimos_append_str(line, n, "[deimos]   first ");
+    n = deimos_append_int(line, n, r->x);
+    n = deimos_append_str(line, n, ",");
+    n = deimos_append_int(line, n, r->y);
+    n = deimos_append_str(line, n, " is ");
+    n = append_colour(line, n, r->incremental);
+    n = deimos_append_str(line, n, ", full repaint ");
+    n = append_colour(line, n, r->expected);
+    emit(line, n);
+
+    report_damage(output);
+    report_events();
+    if (g_stats.frames_mismatched == DEIMOS_VERIFY_MAX_REPORTS) {
+        print("[deimos] damage verify: further mismatches are only counted\n");
+    }
+}
+
+void deimos_verify_summary(void) {
+    if (g_stats.frames_checked == 0) return;
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] damage verify: ");
+    n = deimos_append_u32(line, n, g_stats.frames_checked);
+    n = deimos_append_str(line, n, " frames checked, ");
+    n = deimos_append_u32(line, n, g_stats.frames_mismatched);
+    n = deimos_append_str(line, n, " mismatched (");
+    n = deimos_append_u32(line, n, (uint32_t)g_stats.pixels_mismatched);
+    n = deimos_append_str(line, n, " px)");
+    emit(line, n);
+}
+
+const struct deimos_verify_stats *deimos_verify_stats(void) {
+    return &g_stats;
+}
@@ -0,0 +1,32 @@
+#ifndef DEIMOS_COMPOSITOR_DAMAGE_VERIFY_H
+#define DEIMOS_COMPOSITOR_DAMAGE_VERIFY_H
+
+#include <stdint.h>
+#include <libsys.h>
+#include "rendering/rendering.h"
+
+// Damage verifier bookkeeping. main draws every damaged frame a second time
+// as a full repaint (render_verify_begin/end) and hands mismatches here; a
+// report names the first differing pixel, the frame's damage list and the
+// input events of the last few frames, which usually point at the damage
+// that was missed.
+#define DEIMOS_VERIFY_EVENTS 16     // input events remembered for reports
+#define DEIMOS_VERIFY_MAX_REPORTS 8 // detailed reports; later ones are counted
+
+struct deimos_verify_stats {
+    uint32_t frames_checked;
+    uint32_t frames_mismatched;
+    uint64_t pixels_mismatched;
+};
+
+void deimos_verify_note_event(uint32_t frame, const struct user_input_event *ev);
+// Call with the mismatching output still bound and its damage intact.
+void deimos_verify_report(uint32_t frame, int output, const struct render_verify_result *r);
+// Counts a checked frame; mismatched ones are counted by report.
+void deimos_verify_frame_checked(void);
+// Prints the totals if anything was checked.
+void deimos_verify_summary(void);
+
+const struct deimos_verify_stats *deimos_verify_stats(void);
+
+#endif
@@ -0,0 +1,225 @@
+#include "compositor/governor.h"
+#include "util.h"
+#include <libsys.h>
+
+#define GOV_TICK_US 10000U // ticks() runs at 100 Hz
+#define GOV_CALIBRATE_TICKS 100U
+
+static struct deimos_gov_stats g_stats;
+static int g_enabled;
+static int g_pressure_run;
+static int g_headroom_active;
+static uint64_t g_headroom_since;
+static uint64_t g_cooldown_until;
+
+static uint64_t g_cal_tsc;
+static uint64_t g_cal_ticks;
+static uint64_t g_tsc_per_us; // 0 until calibrated
+
+// deimos_gov_clock_us runs at g_clock_per_us from (g_clock_tsc, g_clock_us);
+// a new calibration rebases it there so it never jumps.
+static uint64_t g_clock_tsc;
+static uint64_t g_clock_us;
+static uint64_t g_clock_per_us;
+
+static void calibrate(uint64_t tsc, uint64_t now) {
+    uint64_t elapsed = now - g_cal_ticks;
+    if (elapsed < GOV_CALIBRATE_TICKS) return;
+
+    uint64_t per_us = (tsc - g_cal_tsc) / (elapsed * GOV_TICK_US);
+    if (per_us > 0) {
+        g_tsc_per_us = per_us;
+    }
+    g_cal_tsc = tsc;
+    g_cal_ticks = now;
+}
+
+static void log_change(int from, int to) {
+    static const char *names[DEIMOS_GOV_MAX_LEVEL + 1] = {
+        "full quality", "animations off", "outline drag", "no unfocused decorations", "flat unfocused content"
+    };
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] governor ");
+    n = deimos_append_u32(line, n, (uint32_t)from);
+    n = deimos_append_str(line, n, "->");
+    n = deimos_append_u32(line, n, (uint32_t)to);
+    n = deimos_append_str(line, n, " (");
+    n = deimos_append_str(line, n, names[to]);
+    n = deimos_append_str(line, n, ") avg ");
+    n = deimos_append_u32(line, n, g_stats.avg_frame_us);
+    n = deimos_append_str(line, n, "us budget ");
+    n = deimos_append_u32(line, n, g_stats.budget_us);
+    n = deimos_append_str(line, n, "us\n");
+    line[n] = '\0';
+    print(line);
+}
+
+static int set_level(int level, uint64_t now) {
+    if (level < 0) level = 0;
+    if (level > DEIMOS_GOV_MAX_LEVEL) level = DEIMOS_GOV_MAX_LEVEL;
+    if (level == g_stats.level) return 0;
+
+    log_change(g_stats.level, level);
+    if (level > g_stats.level) {
+        g_stats.degrades[level]++;
+    } else {
+        g_stats.restores[level]++;
+    }
+    g_stats.level = level;
+    g_pressure_run = 0;
+    g_headroom_active = 0;
+    g_cooldown_until = now + DEIMOS_GOV_COOLDOWN_TICKS;
+    return 1;
+}
+
+static int note_headroom(uint64_t now) {
+    g_pressure_run = 0;
+    if (!g_headroom_active) {
+        g_headroom_active = 1;
+        g_headroom_since = now;
+        return 0;
+    }
+    if (g_stats.level > 0 && now - g_headroom_since >= DEIMOS_GOV_HEADROOM_TICKS) {
+        return set_level(g_stats.level - 1, now);
+    }
+    return 0;
+}
+
+void deimos_gov_init(int target_fps) {
+    g_enabled = target_fps > 0;
+    g_stats.level = 0;
+    g_stats.budget_us = g_enabled ? 1000000U / (uint32_t)target_fps : 0;
+    g_stats.last_frame_us = 0;
+    g_stats.avg_frame_us = 0;
+    g_stats.frames_measured = 0;
+    g_stats.frames_over_budget = 0;
+    for (int i = 0; i <= DEIMOS_GOV_MAX_LEVEL; i++) {
+        g_stats.degrades[i] = 0;
+        g_stats.restores[i] = 0;
+    }
+    g_pressure_run = 0;
+    g_headroom_active = 0;
+    g_cooldown_until = 0;
+    g_cal_tsc = deimos_tsc();
+    g_cal_ticks = ticks();
+    g_tsc_per_us = 0;
+}
+
+uint64_t deimos_gov_clock_us(void) {
+    uint64_t tsc = deimos_tsc();
+    uint64_t now = ticks();
+    calibrate(tsc, now);
+    if (!g_tsc_per_us) {
+        // Until the first calibration, the 10 ms ticks() steps.
+        if (now * GOV_TICK_US > g_clock_us) g_clock_us = now * GOV_TICK_US;
+        g_clock_tsc = tsc;
+        return g_clock_us;
+    }
+    if (g_clock_per_us != g_tsc_per_us) {
+        if (g_clock_per_us) g_clock_us += (tsc - g_clock_tsc) / g_clock_per_us;
+        g_clock_tsc = tsc;
+        g_clock_per_us = g_tsc_per_us;
+    }
+    return g_clock_us + (tsc - g_clock_tsc) / g_clock_per_us;
+}
+
+int deimos_gov_allows(int feature) {
+    return feature > g_stats.level;
+}
+
+int deimos_gov_level(void) {
+    return g_stats.level;
+}
+
+uint64_t deimos_gov_begin_frame(void) {
+    return deimos_tsc();
+}
+
+int deimos_gov_end_frame(uint64_t begin) {
+    if (!g_enabled) return 0;
+
+    uint64_t end = deimos_tsc();
+    uint64_t now = ticks();
+    calibrate(end, now);
+    if (!g_tsc_per_us) return 0;
+
+    uint64_t us = (end - begin) / g_tsc_per_us;
+    if (us > 0xFFFFFFFFULL) us = 0xFFFFFFFFULL;
+    g_stats.last_frame_us = (uint32_t)us;
+    // EWMA with 1/8 weight so single spikes do not trip the governor.
+    if (g_stats.frames_measured == 0) {
+        g_stats.avg_frame_us = g_stats.last_frame_us;
+    } else {
+        g_stats.avg_frame_us = g_stats.avg_frame_us - (g_stats.avg_frame_us >> 3) + (g_stats.last_frame_us >> 3);
+    }
+    g_stats.frames_measured++;
+    if (g_stats.last_frame_us > g_stats.budget_us) {
+        g_stats.frames_over_budget++;
+    }
+
+    if (now < g_cooldown_until) return 0;
+
+    uint32_t pressure_us = (g_stats.budget_us * DEIMOS_GOV_PRESSURE_PERCENT) / 100U;
+    uint32_t headroom_us = (g_stats.budget_us * DEIMOS_GOV_HEADROOM_PERCENT) / 100U;
+    if (g_stats.avg_frame_us > pressure_us) {
+        g_headroom_active = 0;
+        if (++g_pressure_run >= DEIMOS_GOV_PRESSURE_FRAMES && g_stats.level < DEIMOS_GOV_MAX_LEVEL) {
+            return set_level(g_stats.level + 1, now);
+        }
+        return 0;
+    }
+    if (g_stats.avg_frame_us < headroom_us) {
+        return note_headroom(now);
+    }
+
+    // Between the thresholds: hold the current level.
+    g_pressure_run = 0;
+    g_headroom_active = 0;
+    return 0;
+}
+
+int deimos_gov_idle_frame(void) {
+    if (!g_enabled) return 0;
+
+    uint64_t now = ticks();
+    calibrate(deimos_tsc(), now);
+    if (!g_tsc_per_us || now < g_cooldown_until) return 0;
+    return note_headroom(now);
+}
+
+const struct deimos_gov_stats *deimos_gov_stats(void) {
+    return &g_stats;
+}
+
+void deimos_gov_summary(void) {
+    if (!g_enabled) return;
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] governor: ");
+    n = deimos_append_u32(line, n, g_stats.frames_over_budget);
+    n = deimos_append_str(line, n, " of ");
+    n = deimos_append_u32(line, n, g_stats.frames_measured);
+    n = deimos_append_str(line, n, " frames over the ");
+    n = deimos_append_u32(line, n, g_stats.budget_us);
+    n = deimos_append_str(line, n, "us budget, final level ");
+    n = deimos_append_u32(line, n, (uint32_t)g_stats.level);
+    n = deimos_append_str(line, n, "\n");
+    line[n] = '\0';
+    print(line);
+
+    n = 0;
+    n = deimos_append_str(line, n, "[deimos] governor: entered/left per level");
+    for (int level = 1; level <= DEIMOS_GOV_MAX_LEVEL; level++) {
+        n = deimos_append_str(line, n, " ");
+        n = deimos_append_u32(line, n, (uint32_t)level);
+        n = deimos_append_str(line, n, ":");
+        n = deimos_append_u32(line, n, g_stats.degrades[level]);
+        n = deimos_append_str(line, n, "/");
+        n = deimos_append_u32(line, n, g_stats.restores[level - 1]);
+    }
+    n = deimos_append_str(line, n, "\n");
+    line[n] = '\0';
+    print(line);
+}
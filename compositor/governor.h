@@ -0,0 +1,52 @@
+#ifndef DEIMOS_COMPOSITOR_GOVERNOR_H
+#define DEIMOS_COMPOSITOR_GOVERNOR_H
+
+#include <stdint.h>
+
+// Quality governor. Frame time (TSC, calibrated against ticks()) is compared
+// with the budget for the target frame rate; sustained pressure raises the
+// degradation level one step, sustained headroom lowers it again. Level N
+// disables the first N features below, cheapest-to-lose first.
+#define DEIMOS_GOV_ANIMATION 1       // layout transitions snap
+#define DEIMOS_GOV_DRAG_PREVIEW 2    // drag preview drawn as an outline
+#define DEIMOS_GOV_DECORATIONS 3     // no title strip on unfocused windows
+#define DEIMOS_GOV_SURFACE_DETAIL 4  // unfocused content is a flat fill
+#define DEIMOS_GOV_MAX_LEVEL 4
+
+#define DEIMOS_GOV_PRESSURE_PERCENT 90   // of budget, degrade after...
+#define DEIMOS_GOV_PRESSURE_FRAMES 8     // ...this many frames in a row
+#define DEIMOS_GOV_HEADROOM_PERCENT 50   // of budget, restore after...
+#define DEIMOS_GOV_HEADROOM_TICKS 200    // ...this long without pressure
+#define DEIMOS_GOV_COOLDOWN_TICKS 50     // no decisions right after a change
+
+struct deimos_gov_stats {
+    int level;
+    uint32_t budget_us;
+    uint32_t last_frame_us;
+    uint32_t avg_frame_us;
+    uint32_t frames_measured;
+    uint32_t frames_over_budget;
+    uint32_t degrades[DEIMOS_GOV_MAX_LEVEL + 1]; // indexed by the level entered
+    uint32_t restores[DEIMOS_GOV_MAX_LEVEL + 1];
+};
+
+void deimos_gov_init(int target_fps); // 0 keeps every feature on
+// Monotonic microseconds on the governor's calibrated TSC, for anything that
+// must move more smoothly than the 100 Hz ticks() (layout transitions).
+uint64_t deimos_gov_clock_us(void);
+int deimos_gov_allows(int feature);
+int deimos_gov_level(void);
+
+// Bracket the work of one composed frame. end returns 1 if the level changed.
+uint64_t deimos_gov_begin_frame(void);
+int deimos_gov_end_frame(uint64_t begin);
+// Loop iterations with nothing to draw; they never break a headroom streak,
+// so an idle desktop returns to full quality. Returns 1 if the level changed.
+int deimos_gov_idle_frame(void);
+
+const struct deimos_gov_stats *deimos_gov_stats(void);
+// Prints frames over budget and the degrade/restore counts per level; silent
+// when the governor is off.
+void deimos_gov_summary(void);
+
+#endif
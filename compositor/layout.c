@@ -0,0 +1,324 @@
+#include "compositor/layout.h"
+#include "compositor/animation.h"
+#include "rendering/rendering.h"
+#include "window_manager/state.h"
+
+extern int deimos_compositor_layout_with_count(int window_count);
+extern void mt_heap_reset(void);
+
+// g_window_rects is the published (on-screen) table; g_next_window_rects is
+// filled from the mt-lang rect buffer by deimos_publish_layout() and diffed
+// against g_target_rects, the previous layout result. While a window animates
+// its published rect trails its target.
+static struct deimos_window_rect g_window_rects[DEIMOS_MAX_REPORT_WINDOWS];
+static struct deimos_window_rect g_next_window_rects[DEIMOS_MAX_REPORT_WINDOWS];
+static struct deimos_window_rect g_target_rects[DEIMOS_MAX_REPORT_WINDOWS];
+static int g_window_rect_count;
+static int g_next_window_rect_count;
+static int g_target_rect_count;
+static int g_layout_serial;
+static int g_float_margin;
+
+// One-shot animation origin for the next run (e.g. a dropped drag preview).
+static int g_origin_window_id = -1;
+static struct render_rect g_origin_rect;
+
+static int g_rect_words[DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_RECT_OUT_STRIDE];
+static struct mt_int_array g_rect_buffer = {
+    DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_RECT_OUT_STRIDE,
+    DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_RECT_OUT_STRIDE,
+    g_rect_words
+};
+
+static struct deimos_split_info g_splits[DEIMOS_MAX_REPORT_WINDOWS];
+static int g_split_words[DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_SPLIT_OUT_STRIDE];
+static struct mt_int_array g_split_buffer = {
+    DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_SPLIT_OUT_STRIDE,
+    DEIMOS_MAX_REPORT_WINDOWS * DEIMOS_SPLIT_OUT_STRIDE,
+    g_split_words
+};
+
+static struct deimos_window_rect *find_rect_by_id(struct deimos_window_rect *rects, int count, int id) {
+    for (int i = 0; i < count; i++) {
+        if (rects[i].valid && rects[i].id == id) {
+            return &rects[i];
+        }
+    }
+    return 0;
+}
+
+static int rect_equals(const struct deimos_window_rect *a, const struct deimos_window_rect *b) {
+    if (!a || !b) return 0;
+    return (a->x == b->x) && (a->y == b->y) && (a->w == b->w) && (a->h == b->h) &&
+           (a->floating == b->floating);
+}
+
+static void mark_rect_dirty(const struct deimos_window_rect *r) {
+    if (!r || !r->valid) return;
+    int m = r->floating ? g_float_margin : 0;
+    render_mark_dirty_rect(r->x - m, r->y - m, r->w + 2 * m, r->h + 2 * m);
+}
+
+static void to_render_rect(const struct deimos_window_rect *r, struct render_rect *out) {
+    out->x = r->x;
+    out->y = r->y;
+    out->w = r->w;
+    out->h = r->h;
+}
+
+static void set_rect_geometry(struct deimos_window_rect *r, const struct render_rect *g) {
+    r->x = g->x;
+    r->y = g->y;
+    r->w = g->w;
+    r->h = g->h;
+}
+
+// Diffs the new layout against the previous target. Windows whose target moved
+// either start a transition from their on-screen rect (nothing is damaged
+// until deimos_layout_animate moves them) or snap, damaging old and new rects.
+// Fills `shown` with the rects to publish, in next order.
+static int resolve_next_rects(struct deimos_window_rect *shown, uint64_t now, int animate) {
+    int changed = 0;
+
+    for (int i = 0; i < g_window_rect_count; i++) {
+        if (!g_window_rects[i].valid) continue;
+        if (!find_rect_by_id(g_next_window_rects, g_next_window_rect_count, g_window_rects[i].id)) {
+            mark_rect_dirty(&g_window_rects[i]);
+            deimos_anim_cancel(g_window_rects[i].id);
+            changed++;
+        }
+    }
+
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        shown[i] = g_next_window_rects[i];
+        struct deimos_window_rect *next = &g_next_window_rects[i];
+        if (i >= g_next_window_rect_count || !next->valid) continue;
+
+        struct deimos_window_rect *cur = find_rect_by_id(g_window_rects, g_window_rect_count, next->id);
+        struct deimos_window_rect *prev_target = find_rect_by_id(g_target_rects, g_target_rect_count, next->id);
+        if (!cur) {
+            deimos_anim_cancel(next->id);
+            mark_rect_dirty(next);
+            changed++;
+            continue;
+        }
+        if (prev_target && rect_equals(prev_target, next)) {
+            // Same target: keep whatever is on screen (possibly mid-transition).
+            struct render_rect on_screen;
+            to_render_rect(cur, &on_screen);
+            set_rect_geometry(&shown[i], &on_screen);
+            continue;
+        }
+
+        changed++;
+        struct render_rect from;
+        struct render_rect to;
+        to_render_rect(cur, &from);
+        to_render_rect(next, &to);
+        if (next->id == g_origin_window_id) {
+            from = g_origin_rect;
+        }
+
+        if (animate && cur->floating == next->floating && deimos_anim_start(next->id, &from, &to, now)) {
+            set_rect_geometry(&shown[i], &from);
+            if (next->id == g_origin_window_id) {
+                mark_rect_dirty(cur);
+                mark_rect_dirty(&shown[i]);
+            }
+        } else {
+            deimos_anim_cancel(next->id);
+            mark_rect_dirty(cur);
+            mark_rect_dirty(next);
+        }
+    }
+
+    g_origin_window_id = -1;
+    return changed;
+}
+
+static void publish_next_rects(const struct deimos_window_rect *shown) {
+    g_window_rect_count = g_next_window_rect_count;
+    g_target_rect_count = g_next_window_rect_count;
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        g_window_rects[i] = shown[i];
+        g_target_rects[i] = g_next_window_rects[i];
+    }
+    g_layout_serial++;
+}
+
+int deimos_layout_run(int window_count, uint64_t now, int animate) {
+    g_next_window_rect_count = 0;
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        g_next_window_rects[i].valid = 0;
+        g_split_words[i * DEIMOS_SPLIT_OUT_STRIDE + 1] = 0;
+    }
+    mt_heap_reset();
+    deimos_compositor_layout_with_count(window_count);
+
+    struct deimos_window_rect shown[DEIMOS_MAX_REPORT_WINDOWS];
+    int changed = resolve_next_rects(shown, now, animate);
+    publish_next_rects(shown);
+    return changed;
+}
+
+int deimos_layout_animate(uint64_t now) {
+    int running = 0;
+    int moved = 0;
+
+    for (int i = 0; i < g_window_rect_count; i++) {
+        struct deimos_window_rect *r = &g_window_rects[i];
+        if (!r->valid || !deimos_anim_active(r->id)) continue;
+
+        struct render_rect next;
+        if (deimos_anim_sample(r->id, now, &next)) {
+            running++;
+        }
+        if (next.x == r->x && next.y == r->y && next.w == r->w && next.h == r->h) continue;
+
+        // Damage is the union of the old and new rect of each moving window.
+        mark_rect_dirty(r);
+        set_rect_geometry(r, &next);
+        mark_rect_dirty(r);
+        moved = 1;
+    }
+
+    if (moved) {
+        g_layout_serial++;
+    }
+    return running;
+}
+
+void deimos_layout_set_float_margin(int px) {
+    g_float_margin = (px > 0) ? px : 0;
+}
+
+int deimos_layout_float_margin(void) {
+    return g_float_margin;
+}
+
+int deimos_layout_border(void) {
+    return render_ui_scale();
+}
+
+void deimos_layout_set_origin(int window_id, int x, int y, int w, int h) {
+    g_origin_window_id = window_id;
+    g_origin_rect.x = x;
+    g_origin_rect.y = y;
+    g_origin_rect.w = w;
+    g_origin_rect.h = h;
+}
+
+void deimos_layout_adopt(const struct deimos_window_rect *rects, int count) {
+    if (count < 0) count = 0;
+    if (count > DEIMOS_MAX_REPORT_WINDOWS) count = DEIMOS_MAX_REPORT_WINDOWS;
+
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        if (i < count) {
+            g_window_rects[i] = rects[i];
+            deimos_anim_cancel(rects[i].id);
+        } else {
+            g_window_rects[i].valid = 0;
+        }
+        g_target_rects[i] = g_window_rects[i];
+    }
+    g_window_rect_count = count;
+    g_target_rect_count = count;
+    g_layout_serial++;
+}
+
+int deimos_layout_count(void) {
+    return g_window_rect_count;
+}
+
+const struct deimos_window_rect *deimos_layout_rect_at(int index) {
+    if (index < 0 || index >= g_window_rect_count) return 0;
+    if (!g_window_rects[index].valid) return 0;
+    return &g_window_rects[index];
+}
+
+const struct deimos_window_rect *deimos_layout_find(int window_id) {
+    return find_rect_by_id(g_window_rects, g_window_rect_count, window_id);
+}
+
+int deimos_layout_serial(void) {
+    return g_layout_serial;
+}
+
+const struct deimos_split_info *deimos_layout_split(int index) {
+    if (index <= 0 || index >= DEIMOS_MAX_REPORT_WINDOWS) return 0;
+    if (!g_splits[index].valid) return 0;
+    return &g_splits[index];
+}
+
+int deimos_layout_split_at(int x, int y, int band) {
+    for (int i = g_window_rect_count - 1; i > 0; i--) {
+        const struct deimos_split_info *sp = &g_splits[i];
+        if (!sp->valid) continue;
+
+        if (sp->orient == DEIMOS_SPLIT_ORIENT_VERTICAL) {
+            if (y < sp->y || y >= sp->y + sp->h) continue;
+            if (x >= sp->boundary - band && x < sp->boundary + band) return i;
+        } else {
+            if (x < sp->x || x >= sp->x + sp->w) continue;
+            if (y >= sp->boundary - band && y < sp->boundary + band) return i;
+        }
+    }
+    return -1;
+}
+
+void deimos_layout_pin_splits(void) {
+    for (int i = 1; i < g_window_rect_count; i++) {
+        const struct deimos_split_info *sp = &g_splits[i];
+        if (!sp->valid) continue;
+
+        // Window IDs are assigned in compositor from 1..N.
+        deimos_wm_pin_split(i, sp->target_index + 1, sp->orient, sp->side);
+    }
+}
+
+struct mt_int_array *deimos_layout_rect_buffer(void) {
+    return &g_rect_buffer;
+}
+
+struct mt_int_array *deimos_layout_split_buffer(void) {
+    return &g_split_buffer;
+}
+
+void deimos_publish_layout(int count) {
+    if (count < 0) count = 0;
+    if (count > DEIMOS_MAX_REPORT_WINDOWS) count = DEIMOS_MAX_REPORT_WINDOWS;
+
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        struct deimos_window_rect *r = &g_next_window_rects[i];
+        if (i >= count) {
+            r->valid = 0;
+            continue;
+        }
+
+        const int *words = &g_rect_words[i * DEIMOS_RECT_OUT_STRIDE];
+        r->id = words[0];
+        r->x = words[1];
+        r->y = words[2];
+        r->w = words[3];
+        r->h = words[4];
+        r->floating = words[5];
+        r->valid = 1;
+    }
+    g_next_window_rect_count = count;
+
+    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        struct deimos_split_info *sp = &g_splits[i];
+        const int *words = &g_split_words[i * DEIMOS_SPLIT_OUT_STRIDE];
+        sp->valid = (i > 0 && i < count && words[1] != DEIMOS_SPLIT_ORIENT_AUTO);
+        if (!sp->valid) continue;
+
+        sp->target_index = words[0];
+        sp->orient = words[1];
+        sp->side = words[2];
+        sp->x = words[3];
+        sp->y = words[4];
+        sp->w = words[5];
+        sp->h = words[6];
+        sp->boundary = words[7];
+    }
+}
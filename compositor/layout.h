@@ -0,0 +1,78 @@
+#ifndef DEIMOS_COMPOSITOR_LAYOUT_H
+#define DEIMOS_COMPOSITOR_LAYOUT_H
+
+#include <stdint.h>
+#include "compositor/shared_state.h"
+
+#define DEIMOS_MAX_REPORT_WINDOWS 16
+
+struct deimos_window_rect {
+    int id;
+    int x;
+    int y;
+    int w;
+    int h;
+    int floating;
+    int valid;
+};
+
+// How split `index` (the split that created window index + 1) divided its
+// parent rect, as resolved by the last layout run.
+struct deimos_split_info {
+    int target_index;
+    int orient;   // DEIMOS_SPLIT_ORIENT_VERTICAL/HORIZONTAL
+    int side;     // 0 = new window took the left/top half
+    int x;
+    int y;
+    int w;
+    int h;
+    int boundary; // absolute x (vertical) or y (horizontal) of the split line
+    int valid;
+};
+
+// Layout stage: runs the mt-lang layout once, diffs the new rect table against
+// the previous result, marks only changed areas dirty and publishes it. With
+// `animate`, moved windows transition from their on-screen rect instead of
+// snapping. Returns the number of windows whose rect changed.
+int deimos_layout_run(int window_count, uint64_t now, int animate);
+
+// Advances running transitions to `now`, damaging the old and new rect of each
+// window that moved. Returns the number still running.
+int deimos_layout_animate(uint64_t now);
+
+// Floating windows paint this far outside their rect (drop shadows); their
+// damage and spatial footprint grow by the same margin.
+void deimos_layout_set_float_margin(int px);
+int deimos_layout_float_margin(void);
+
+// Window border thickness, one UI scale unit. Content is drawn, and client
+// damage mapped, inside it.
+int deimos_layout_border(void);
+
+// Makes the next run animate window_id from this rect (e.g. a dropped preview).
+void deimos_layout_set_origin(int window_id, int x, int y, int w, int h);
+
+// Replaces the published table with one that is already on screen (e.g. a
+// restored workspace snapshot) without marking damage; the next run diffs
+// against it.
+void deimos_layout_adopt(const struct deimos_window_rect *rects, int count);
+
+// Published rect table, read by the draw stage and hit-testing.
+int deimos_layout_count(void);
+const struct deimos_window_rect *deimos_layout_rect_at(int index);
+const struct deimos_window_rect *deimos_layout_find(int window_id);
+int deimos_layout_serial(void); // bumped on every publish
+const struct deimos_split_info *deimos_layout_split(int index);
+// Innermost split whose boundary line lies within `band` pixels of (x, y).
+int deimos_layout_split_at(int x, int y, int band);
+// Pins every split to its resolved tree position (see deimos_wm_pin_split).
+void deimos_layout_pin_splits(void);
+
+// Exposed for compositor.mtc extern calls. The compositor fills the flat
+// rect buffer (DEIMOS_RECT_OUT_STRIDE words per window) and split buffer
+// (DEIMOS_SPLIT_OUT_STRIDE words per split) and publishes them once.
+struct mt_int_array *deimos_layout_rect_buffer(void);
+struct mt_int_array *deimos_layout_split_buffer(void);
+void deimos_publish_layout(int count);
+
+#endif
@@ -0,0 +1,117 @@
+#include "compositor/region.h"
+
+static void region_degrade(struct deimos_region *region) {
+    region->overflow = 1;
+    region->count = 1;
+    region->rects[0] = region->bounds;
+}
+
+void deimos_region_set_rect(struct deimos_region *region, int x, int y, int w, int h) {
+    if (!region) return;
+
+    region->overflow = 0;
+    region->bounds.x = x;
+    region->bounds.y = y;
+    region->bounds.w = w;
+    region->bounds.h = h;
+    if (w <= 0 || h <= 0) {
+        region->count = 0;
+        return;
+    }
+    region->count = 1;
+    region->rects[0] = region->bounds;
+}
+
+void deimos_region_clear(struct deimos_region *region) {
+    if (!region) return;
+    deimos_region_set_rect(region, 0, 0, 0, 0);
+}
+
+void deimos_region_copy(struct deimos_region *dst, const struct deimos_region *src) {
+    if (!dst || !src) return;
+
+    dst->count = src->count;
+    dst->overflow = src->overflow;
+    dst->bounds = src->bounds;
+    for (int i = 0; i < src->count; i++) {
+        dst->rects[i] = src->rects[i];
+    }
+}
+
+static int region_push(struct render_rect *out, int *count, int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0) return 1;
+    if (*count >= DEIMOS_REGION_MAX_RECTS) return 0;
+    out[*count].x = x;
+    out[*count].y = y;
+    out[*count].w = w;
+    out[*count].h = h;
+    (*count)++;
+    return 1;
+}
+
+void deimos_region_subtract_rect(struct deimos_region *region, const struct render_rect *cut) {
+    if (!region || !cut || region->overflow) return;
+    if (cut->w <= 0 || cut->h <= 0) return;
+
+    struct render_rect out[DEIMOS_REGION_MAX_RECTS];
+    int count = 0;
+    int cx1 = cut->x + cut->w;
+    int cy1 = cut->y + cut->h;
+
+    for (int i = 0; i < region->count; i++) {
+        const struct render_rect *r = &region->rects[i];
+        int rx1 = r->x + r->w;
+        int ry1 = r->y + r->h;
+        int ok = 1;
+
+        if (cut->x >= rx1 || cx1 <= r->x || cut->y >= ry1 || cy1 <= r->y) {
+            ok = region_push(out, &count, r->x, r->y, r->w, r->h);
+        } else {
+            int iy0 = (cut->y > r->y) ? cut->y : r->y;
+            int iy1 = (cy1 < ry1) ? cy1 : ry1;
+            int ix0 = (cut->x > r->x) ? cut->x : r->x;
+            int ix1 = (cx1 < rx1) ? cx1 : rx1;
+
+            // Full-width bands above/below the cut, then the side pieces.
+            ok = region_push(out, &count, r->x, r->y, r->w, iy0 - r->y) &&
+                 region_push(out, &count, r->x, iy1, r->w, ry1 - iy1) &&
+                 region_push(out, &count, r->x, iy0, ix0 - r->x, iy1 - iy0) &&
+                 region_push(out, &count, ix1, iy0, rx1 - ix1, iy1 - iy0);
+        }
+
+        if (!ok) {
+            region_degrade(region);
+            return;
+        }
+    }
+
+    region->count = count;
+    for (int i = 0; i < count; i++) {
+        region->rects[i] = out[i];
+    }
+}
+
+void deimos_region_subtract(struct deimos_region *region, const struct deimos_region *cut) {
+    if (!region || !cut) return;
+    for (int i = 0; i < cut->count; i++) {
+        deimos_region_subtract_rect(region, &cut->rects[i]);
+    }
+}
+
+int deimos_region_contains_point(const struct deimos_region *region, int x, int y) {
+    if (!region) return 0;
+    for (int i = 0; i < region->count; i++) {
+        const struct render_rect *r = &region->rects[i];
+        if (x >= r->x && y >= r->y && x < r->x + r->w && y < r->y + r->h) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void deimos_region_mark_dirty(const struct deimos_region *region) {
+    if (!region) return;
+    for (int i = 0; i < region->count; i++) {
+        render_mark_dirty_rect(region->rects[i].x, region->rects[i].y, region->rects[i].w, region->rects[i].h);
+    }
+}
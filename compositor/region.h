@@ -0,0 +1,27 @@
+#ifndef DEIMOS_COMPOSITOR_REGION_H
+#define DEIMOS_COMPOSITOR_REGION_H
+
+#include "rendering/rendering.h"
+
+#define DEIMOS_REGION_MAX_RECTS 32
+
+// Disjoint rect list. When an operation would need more than
+// DEIMOS_REGION_MAX_RECTS pieces the region degrades to its original bounds
+// and sets `overflow`; callers must then fall back to painter's order.
+struct deimos_region {
+    int count;
+    int overflow;
+    struct render_rect bounds;
+    struct render_rect rects[DEIMOS_REGION_MAX_RECTS];
+};
+
+void deimos_region_set_rect(struct deimos_region *region, int x, int y, int w, int h);
+void deimos_region_clear(struct deimos_region *region);
+void deimos_region_copy(struct deimos_region *dst, const struct deimos_region *src);
+void deimos_region_subtract_rect(struct deimos_region *region, const struct render_rect *cut);
+void deimos_region_subtract(struct deimos_region *region, const struct deimos_region *cut);
+int deimos_region_contains_point(const struct deimos_region *region, int x, int y);
+// Marks every rect of the region dirty in the renderer.
+void deimos_region_mark_dirty(const struct deimos_region *region);
+
+#endif
@@ -0,0 +1,591 @@
+#include "compositor/remote.h"
+#include "compositor/layout.h"
+#include "compositor/region.h"
+#include "rendering/convert.h"
+#include "rendering/rendering.h"
+#include "trace.h"
+
+#define REMOTE_MAX_PENDING 64
+#define REMOTE_OUT_BYTES (64 * 1024)
+#define REMOTE_IN_BYTES 256
+#define REMOTE_EVENT_QUEUE 64
+#define REMOTE_MAX_PIECES 256
+// Every disjoint piece of a frame's coalesced damage.
+#define REMOTE_MAX_TX_RECTS (REMOTE_MAX_PENDING * DEIMOS_REGION_MAX_RECTS)
+
+static int g_out_fd = -1;
+static int g_in_fd = -1;
+static uint32_t g_sent_serial;
+static uint32_t g_acked_serial;
+static struct deimos_remote_stats g_stats;
+
+// Damage presented since the last send, not yet seen by the viewer.
+static struct render_rect g_pending[REMOTE_MAX_PENDING];
+static int g_pending_count;
+static int g_pending_full;
+static int g_pending_frames;
+
+// What the viewer shows (same layout as the backbuffer), and where each
+// window was in it. Carved from the frame pool when export starts.
+static uint8_t *g_shadow;
+static uint32_t g_shadow_bytes;
+static struct deimos_window_rect g_sent_rects[DEIMOS_MAX_REPORT_WINDOWS + 1];
+
+// Bytes g_out_pos..g_out_len of g_out are encoded but not yet taken by the
+// stream.
+static uint8_t g_out[REMOTE_OUT_BYTES];
+static int g_out_len;
+static int g_out_pos;
+
+// The frame going out. Its rects were committed to the shadow when it was
+// built, so they are encoded from there a bufferful at a time, as fast as the
+// stream drains; the backbuffer may have moved on meanwhile.
+static struct render_rect g_tx_rects[REMOTE_MAX_TX_RECTS];
+static uint8_t g_tx_rle[REMOTE_MAX_TX_RECTS];
+static int g_tx_count;
+static int g_tx_rect; // next rect to encode
+static int g_tx_row;  // its next row, -1 before its header
+static int g_tx_x;    // next pixel of that row
+static int g_tx_open; // 1 from building a frame until its last byte is written
+static uint64_t g_tx_base; // bytes_sent when the frame was built
+
+static uint8_t g_in[REMOTE_IN_BYTES];
+static int g_in_len;
+static struct user_input_event g_events[REMOTE_EVENT_QUEUE];
+static int g_event_head;
+static int g_event_count;
+static uint32_t g_pointer_buttons;
+static int g_pointer_x;
+static int g_pointer_y;
+
+// Writes what the stream takes without waiting for it; the rest stays for a
+// later pump. Returns 1 once g_out is empty.
+static int flush_out(void) {
+    while (g_out_fd >= 0 && g_out_pos < g_out_len) {
+        int n = write(g_out_fd, &g_out[g_out_pos], g_out_len - g_out_pos);
+        if (n == 0) return 0; // stream full
+        if (n < 0) {
+            print("[deimos] remote: viewer gone, export stopped\n");
+            deimos_remote_stop();
+            return 0;
+        }
+        g_out_pos += n;
+        g_stats.bytes_sent += (uint64_t)n;
+    }
+    g_out_len = 0;
+    g_out_pos = 0;
+    return g_out_fd >= 0;
+}
+
+static int out_room(void) {
+    return REMOTE_OUT_BYTES - g_out_len;
+}
+
+// Callers check out_room first; nothing here waits for the stream.
+static void put_u8(uint32_t v) {
+    g_out[g_out_len++] = (uint8_t)v;
+}
+
+static void put_u16(uint32_t v) {
+    put_u8(v & 0xFF);
+    put_u8((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint32_t v) {
+    put_u16(v & 0xFFFF);
+    put_u16(v >> 16);
+}
+
+static void put_rect(const struct render_rect *r) {
+    put_u16((uint32_t)r->x);
+    put_u16((uint32_t)r->y);
+    put_u16((uint32_t)r->w);
+    put_u16((uint32_t)r->h);
+}
+
+static void put_pixel(const uint8_t *p, int bytes) {
+    for (int i = 0; i < bytes; i++) put_u8(p[i]);
+}
+
+static void put_pixels(const uint8_t *p, int n) {
+    uint8_t *out = &g_out[g_out_len];
+    for (int i = 0; i < n; i++) out[i] = p[i];
+    g_out_len += n;
+}
+
+static int pixel_equal(const uint8_t *a, const uint8_t *b, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static int rows_equal(const uint8_t *a, const uint8_t *b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static void add_pending(int x, int y, int w, int h) {
+    if (g_pending_full) return;
+    if (g_pending_count >= REMOTE_MAX_PENDING) {
+        g_pending_full = 1;
+        return;
+    }
+    struct render_rect *r = &g_pending[g_pending_count++];
+    r->x = x;
+    r->y = y;
+    r->w = w;
+    r->h = h;
+}
+
+static void push_event(const struct user_input_event *ev) {
+    if (g_event_count >= REMOTE_EVENT_QUEUE) return; // drop: input_poll would too
+    g_events[(g_event_head + g_event_count) % REMOTE_EVENT_QUEUE] = *ev;
+    g_event_count++;
+}
+
+static void pointer_event(int x, int y, uint32_t buttons, uint8_t modifiers) {
+    struct user_input_event ev;
+    ev.type = INPUT_EVENT_MOUSE_MOVE;
+    ev.pressed = 0;
+    ev.modifiers = modifiers;
+    ev.key = 0;
+    ev.scancode = 0;
+    ev.mouse_x = x;
+    ev.mouse_y = y;
+    ev.mouse_buttons = buttons;
+    if (x != g_pointer_x || y != g_pointer_y) {
+        push_event(&ev);
+    }
+
+    // Button changes become button events, scancode = button number.
+    for (int bit = 0; bit < 3; bit++) {
+        uint32_t mask = 1U << bit;
+        if ((buttons ^ g_pointer_buttons) & mask) {
+            ev.type = INPUT_EVENT_MOUSE_BUTTON;
+            ev.pressed = (buttons & mask) ? 1 : 0;
+            ev.scancode = (uint16_t)(bit + 1);
+            push_event(&ev);
+        }
+    }
+    g_pointer_x = x;
+    g_pointer_y = y;
+    g_pointer_buttons = buttons;
+}
+
+static void read_input(void) {
+    if (g_in_fd < 0) return;
+
+    int n = read(g_in_fd, &g_in[g_in_len], REMOTE_IN_BYTES - g_in_len);
+    if (n > 0) g_in_len += n;
+
+    int pos = 0;
+    while (pos < g_in_len) {
+        const uint8_t *m = &g_in[pos];
+        int left = g_in_len - pos;
+        int size;
+        if (m[0] == DEIMOS_REMOTE_ACK) {
+            size = 5;
+            if (left < size) break;
+            uint32_t serial = (uint32_t)m[1] | ((uint32_t)m[2] << 8) | ((uint32_t)m[3] << 16) | ((uint32_t)m[4] << 24);
+            if (serial <= g_sent_serial) g_acked_serial = serial;
+        } else if (m[0] == DEIMOS_REMOTE_POINTER) {
+            size = 7;
+            if (left < size) break;
+            int x = (int)(int16_t)(m[1] | (m[2] << 8));
+            int y = (int)(int16_t)(m[3] | (m[4] << 8));
+            pointer_event(x, y, m[5], m[6]);
+        } else if (m[0] == DEIMOS_REMOTE_KEY) {
+            size = 6;
+            if (left < size) break;
+            struct user_input_event ev;
+            ev.type = INPUT_EVENT_KEYBOARD;
+            ev.key = m[1];
+            ev.pressed = m[2];
+            ev.modifiers = m[3];
+            ev.scancode = (uint16_t)(m[4] | (m[5] << 8));
+            ev.mouse_x = g_pointer_x;
+            ev.mouse_y = g_pointer_y;
+            ev.mouse_buttons = g_pointer_buttons;
+            push_event(&ev);
+        } else {
+            size = 1; // resync on unknown bytes
+        }
+        pos += size;
+    }
+
+    for (int i = pos; i < g_in_len; i++) {
+        g_in[i - pos] = g_in[i];
+    }
+    g_in_len -= pos;
+}
+
+static void shadow_store(const struct render_rect *r) {
+    const uint8_t *fb = render_backbuffer();
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+    int row = r->w * bytes;
+    for (int y = r->y; y < r->y + r->h; y++) {
+        long off = (long)y * pitch + (long)r->x * bytes;
+        for (int i = 0; i < row; i++) g_shadow[off + i] = fb[off + i];
+    }
+}
+
+// Viewer-side move of src to dst, replayed on the shadow.
+static void shadow_move(const struct render_rect *src, int dst_x, int dst_y) {
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+    int row = src->w * bytes;
+    int down = dst_y > src->y || (dst_y == src->y && dst_x > src->x);
+    for (int i = 0; i < src->h; i++) {
+        int k = down ? (src->h - 1 - i) : i;
+        uint8_t *d = g_shadow + (long)(dst_y + k) * pitch + (long)dst_x * bytes;
+        const uint8_t *s = g_shadow + (long)(src->y + k) * pitch + (long)src->x * bytes;
+        if (d > s) {
+            for (int b = row - 1; b >= 0; b--) d[b] = s[b];
+        } else {
+            for (int b = 0; b < row; b++) d[b] = s[b];
+        }
+    }
+}
+
+// Shadow at src already holds what the screen now shows at dst.
+static int move_matches(const struct render_rect *src, int dst_x, int dst_y) {
+    const uint8_t *fb = render_backbuffer();
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+    for (int i = 0; i < src->h; i++) {
+        const uint8_t *now = fb + (long)(dst_y + i) * pitch + (long)dst_x * bytes;
+        const uint8_t *was = g_shadow + (long)(src->y + i) * pitch + (long)src->x * bytes;
+        if (!rows_equal(now, was, src->w * bytes)) return 0;
+    }
+    return 1;
+}
+
+static int on_screen(int x, int y, int w, int h) {
+    return w > 0 && h > 0 && x >= 0 && y >= 0 && x + w <= render_width() && y + h <= render_height();
+}
+
+// Windows that only changed position since the last send become COPY
+// updates when the shadow proves the viewer already has their pixels.
+// Returns the number sent and removes their destinations from `pieces`.
+static int send_copies(struct deimos_region *pieces, int piece_count) {
+    int copies = 0;
+    int count = deimos_layout_count();
+    for (int i = 0; i < count; i++) {
+        const struct deimos_window_rect *now = deimos_layout_rect_at(i);
+        if (!now || !now->valid || now->id <= 0 || now->id > DEIMOS_MAX_REPORT_WINDOWS) continue;
+        const struct deimos_window_rect *was = &g_sent_rects[now->id];
+        if (!was->valid || was->w != now->w || was->h != now->h) continue;
+        if (was->x == now->x && was->y == now->y) continue;
+        if (!on_screen(was->x, was->y, was->w, was->h) || !on_screen(now->x, now->y, now->w, now->h)) continue;
+
+        struct render_rect src;
+        src.x = was->x;
+        src.y = was->y;
+        src.w = was->w;
+        src.h = was->h;
+        if (!move_matches(&src, now->x, now->y)) continue;
+
+        put_u8(DEIMOS_REMOTE_COPY);
+        put_rect(&src);
+        put_u16((uint32_t)now->x);
+        put_u16((uint32_t)now->y);
+        shadow_move(&src, now->x, now->y);
+        copies++;
+
+        struct render_rect dst;
+        dst.x = now->x;
+        dst.y = now->y;
+        dst.w = now->w;
+        dst.h = now->h;
+        for (int p = 0; p < piece_count; p++) {
+            deimos_region_subtract_rect(&pieces[p], &dst);
+        }
+    }
+    return copies;
+}
+
+// RLE size of a rect in bytes, used to pick the cheaper encoding.
+static uint32_t rle_size(const struct render_rect *r) {
+    const uint8_t *fb = render_backbuffer();
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+    uint32_t size = 0;
+    for (int y = r->y; y < r->y + r->h; y++) {
+        const uint8_t *row = fb + (long)y * pitch + (long)r->x * bytes;
+        int x = 0;
+        while (x < r->w) {
+            int run = 1;
+            while (x + run < r->w && run < 0xFFFF && pixel_equal(row + (x + run) * bytes, row + x * bytes, bytes)) run++;
+            size += 2U + (uint32_t)bytes;
+            x += run;
+        }
+    }
+    return size;
+}
+
+// Trims rows the viewer already has, picks RAW or RLE, and commits the rect
+// to the shadow and the frame going out.
+static void queue_rect(struct render_rect *r) {
+    const uint8_t *fb = render_backbuffer();
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+
+    while (r->h > 0 && rows_equal(fb + (long)r->y * pitch + (long)r->x * bytes,
+                                  g_shadow + (long)r->y * pitch + (long)r->x * bytes, r->w * bytes)) {
+        r->y++;
+        r->h--;
+    }
+    while (r->h > 0 && rows_equal(fb + (long)(r->y + r->h - 1) * pitch + (long)r->x * bytes,
+                                  g_shadow + (long)(r->y + r->h - 1) * pitch + (long)r->x * bytes, r->w * bytes)) {
+        r->h--;
+    }
+    if (r->h <= 0 || g_tx_count >= REMOTE_MAX_TX_RECTS) return;
+
+    uint32_t raw = (uint32_t)r->w * (uint32_t)r->h * (uint32_t)bytes;
+    int rle = rle_size(r) < raw;
+    if (rle) {
+        g_stats.rle_rects++;
+    } else {
+        g_stats.raw_rects++;
+    }
+    g_tx_rects[g_tx_count] = *r;
+    g_tx_rle[g_tx_count] = (uint8_t)rle;
+    g_tx_count++;
+    shadow_store(r);
+}
+
+// Encodes the frame going out into g_out until it is full or the frame ends.
+static void encode_more(void) {
+    int bytes = render_bpp() / 8;
+    int pitch = render_pitch();
+    while (g_tx_rect < g_tx_count) {
+        const struct render_rect *r = &g_tx_rects[g_tx_rect];
+        if (g_tx_row < 0) {
+            if (out_room() < 9) return;
+            put_u8(g_tx_rle[g_tx_rect] ? DEIMOS_REMOTE_RLE : DEIMOS_REMOTE_RAW);
+            put_rect(r);
+            g_tx_row = 0;
+            g_tx_x = 0;
+        }
+
+        const uint8_t *row = g_shadow + (long)(r->y + g_tx_row) * pitch + (long)r->x * bytes;
+        if (g_tx_rle[g_tx_rect]) {
+            while (g_tx_x < r->w) {
+                if (out_room() < 2 + bytes) return;
+                const uint8_t *px = row + g_tx_x * bytes;
+                int run = 1;
+                while (g_tx_x + run < r->w && run < 0xFFFF && pixel_equal(px + run * bytes, px, bytes)) run++;
+                put_u16((uint32_t)run);
+                put_pixel(px, bytes);
+                g_tx_x += run;
+            }
+        } else {
+            int n = r->w - g_tx_x;
+            if (n > out_room() / bytes) n = out_room() / bytes;
+            if (n <= 0) return;
+            put_pixels(row + g_tx_x * bytes, n * bytes);
+            g_tx_x += n;
+            if (g_tx_x < r->w) return;
+        }
+
+        g_tx_x = 0;
+        if (++g_tx_row == r->h) {
+            g_tx_rect++;
+            g_tx_row = -1;
+        }
+    }
+    if (g_tx_rect == g_tx_count && g_tx_row < 0 && out_room() >= 5) {
+        put_u8(DEIMOS_REMOTE_FRAME_END);
+        put_u32(g_sent_serial);
+        g_tx_row = 0; // end written; done once g_out drains
+    }
+}
+
+// Pushes the frame going out as far as the stream takes it.
+static void drain_out(void) {
+    while (flush_out() && g_tx_open) {
+        if (g_tx_rect == g_tx_count && g_tx_row == 0) {
+            g_tx_open = 0;
+            DEIMOS_TRACE2(REMOTE, g_sent_serial, g_stats.bytes_sent - g_tx_base);
+            break;
+        }
+        encode_more();
+    }
+}
+
+// Builds a frame from the coalesced damage. COPY updates go into g_out at
+// once; rects are committed to the shadow and encoded from it by drain_out.
+static void send_frame(void) {
+    // Coalesced damage as disjoint pieces, so no pixel is sent twice.
+    static struct deimos_region pieces[REMOTE_MAX_PENDING];
+    int piece_count = 0;
+    if (g_pending_full) {
+        deimos_region_set_rect(&pieces[0], 0, 0, render_width(), render_height());
+        piece_count = 1;
+    } else {
+        for (int i = 0; i < g_pending_count; i++) {
+            const struct render_rect *r = &g_pending[i];
+            struct render_rect clipped;
+            int x0 = r->x < 0 ? 0 : r->x;
+            int y0 = r->y < 0 ? 0 : r->y;
+            int x1 = r->x + r->w > render_width() ? render_width() : r->x + r->w;
+            int y1 = r->y + r->h > render_height() ? render_height() : r->y + r->h;
+            if (x1 <= x0 || y1 <= y0) continue;
+            clipped.x = x0;
+            clipped.y = y0;
+            clipped.w = x1 - x0;
+            clipped.h = y1 - y0;
+            deimos_region_set_rect(&pieces[piece_count], clipped.x, clipped.y, clipped.w, clipped.h);
+            for (int j = 0; j < piece_count; j++) {
+                deimos_region_subtract(&pieces[piece_count], &pieces[j]);
+            }
+            piece_count++;
+        }
+    }
+
+    // g_out is empty here, and the header plus one COPY per window fits.
+    g_sent_serial++;
+    g_tx_base = g_stats.bytes_sent;
+    put_u8(DEIMOS_REMOTE_FRAME_BEGIN);
+    put_u32(g_sent_serial);
+
+    g_stats.copies += (uint32_t)send_copies(pieces, piece_count);
+    g_tx_count = 0;
+    g_tx_rect = 0;
+    g_tx_row = -1;
+    g_tx_x = 0;
+    for (int p = 0; p < piece_count; p++) {
+        for (int k = 0; k < pieces[p].count; k++) {
+            struct render_rect r = pieces[p].rects[k];
+            if (r.w > 0 && r.h > 0) queue_rect(&r);
+        }
+    }
+    g_tx_open = 1;
+
+    for (int id = 0; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+        g_sent_rects[id].valid = 0;
+    }
+    int count = deimos_layout_count();
+    for (int i = 0; i < count; i++) {
+        const struct deimos_window_rect *r = deimos_layout_rect_at(i);
+        if (r && r->valid && r->id > 0 && r->id <= DEIMOS_MAX_REPORT_WINDOWS) {
+            g_sent_rects[r->id] = *r;
+        }
+    }
+
+    g_stats.frames_sent++;
+    if (g_pending_frames > 1) g_stats.frames_coalesced += (uint32_t)(g_pending_frames - 1);
+    g_pending_count = 0;
+    g_pending_full = 0;
+    g_pending_frames = 0;
+    drain_out();
+}
+
+int deimos_remote_start(const char *out_path, const char *in_path) {
+    if (!out_path || !out_path[0] || g_out_fd >= 0) return -1;
+    uint32_t bytes = (uint32_t)render_pitch() * (uint32_t)render_height();
+    if (g_shadow_bytes < bytes) {
+        g_shadow = render_frame_alloc(bytes);
+        g_shadow_bytes = g_shadow ? bytes : 0;
+    }
+    if (!g_shadow) {
+        print("[deimos] remote: frame pool full, no viewer shadow\n");
+        return -1;
+    }
+
+    g_out_fd = open(out_path, O_WRONLY);
+    if (g_out_fd < 0) {
+        print("[deimos] remote: cannot open ");
+        print(out_path);
+        print("\n");
+        return -1;
+    }
+    g_in_fd = (in_path && in_path[0]) ? open(in_path, O_RDONLY) : -1;
+
+    g_sent_serial = 0;
+    g_acked_serial = 0;
+    g_pending_count = 0;
+    g_pending_full = 1; // the viewer starts with nothing
+    g_pending_frames = 1;
+    g_out_len = 0;
+    g_out_pos = 0;
+    g_tx_open = 0;
+    g_in_len = 0;
+    g_event_head = 0;
+    g_event_count = 0;
+
+    for (int i = 0; i < 4; i++) put_u8((uint8_t)DEIMOS_REMOTE_MAGIC[i]);
+    put_u32(DEIMOS_REMOTE_VERSION);
+    put_u16((uint32_t)render_width());
+    put_u16((uint32_t)render_height());
+    put_u8((uint32_t)render_format());
+    put_u8((uint32_t)(render_bpp() / 8));
+    flush_out();
+
+    print("[deimos] remote: exporting to ");
+    print(out_path);
+    print(g_in_fd >= 0 ? " (input enabled)\n" : "\n");
+    return 0;
+}
+
+void deimos_remote_stop(void) {
+    if (g_out_fd >= 0) close(g_out_fd);
+    if (g_in_fd >= 0) close(g_in_fd);
+    g_out_fd = -1;
+    g_in_fd = -1;
+    g_out_len = 0;
+    g_out_pos = 0;
+    g_tx_open = 0;
+}
+
+int deimos_remote_active(void) {
+    return g_out_fd >= 0;
+}
+
+void deimos_remote_frame(void) {
+    if (g_out_fd < 0) return;
+
+    if (!render_has_dirty()) {
+        g_pending_full = 1; // like render_present_dirty: no damage presented everything
+    } else {
+        struct render_rect clips[RENDER_MAX_DIRTY_RECTS];
+        int count = render_damage_clip(0, 0, render_width(), render_height(), clips, RENDER_MAX_DIRTY_RECTS);
+        for (int i = 0; i < count; i++) {
+            add_pending(clips[i].x, clips[i].y, clips[i].w, clips[i].h);
+        }
+    }
+    g_pending_frames++;
+    deimos_remote_pump();
+}
+
+void deimos_remote_pump(void) {
+    if (g_out_fd < 0) return;
+
+    read_input();
+    drain_out();
+    // A frame still going out holds the next one back; its damage keeps
+    // coalescing. Without an input stream there are no acks, so the stream's
+    // own pace is the only throttle.
+    int ready = g_out_fd >= 0 && !g_tx_open && g_out_len == 0 &&
+                (g_in_fd < 0 || g_acked_serial == g_sent_serial);
+    if (ready && (g_pending_full || g_pending_count > 0)) {
+        send_frame();
+    }
+}
+
+int deimos_remote_poll_event(struct user_input_event *ev) {
+    if (!ev || g_event_count == 0) return 0;
+    *ev = g_events[g_event_head];
+    g_event_head = (g_event_head + 1) % REMOTE_EVENT_QUEUE;
+    g_event_count--;
+    return 1;
+}
+
+void deimos_remote_get_stats(struct deimos_remote_stats *out) {
+    if (!out) return;
+    *out = g_stats;
+}
@@ -0,0 +1,41 @@
+#ifndef DEIMOS_COMPOSITOR_REMOTE_H
+#define DEIMOS_COMPOSITOR_REMOTE_H
+
+#include <stdint.h>
+#include <libsys.h>
+#include "compositor/remote_protocol.h"
+
+// VNC-style export of the composed screen to one viewer over a pair of
+// streams (see remote_protocol.h). The server keeps a shadow of what the
+// viewer shows. Each frame sends only the coalesced damage since the last
+// acknowledged frame, as copies for windows that moved intact and as raw or
+// RLE rects for the rest. Nothing waits on the viewer: a frame goes out only
+// as fast as the stream takes it, and one that has not been fully written or
+// acknowledged yet holds the next back while its damage keeps coalescing.
+struct deimos_remote_stats {
+    uint32_t frames_sent;
+    uint32_t frames_coalesced; // presented frames merged into a later send
+    uint32_t copies;
+    uint32_t raw_rects;
+    uint32_t rle_rects;
+    uint64_t bytes_sent;
+};
+
+// out_path receives the stream and must not block on writes when full (a
+// write that cannot proceed returns 0); in_path (optional) carries acks and
+// input and must not block on reads when empty. Returns 0 on success.
+int deimos_remote_start(const char *out_path, const char *in_path);
+void deimos_remote_stop(void);
+int deimos_remote_active(void);
+
+// After render_present_dirty, before render_reset_dirty: records the frame's
+// damage and sends if the viewer is ready.
+void deimos_remote_frame(void);
+// Reads acks and input, and sends coalesced damage once the viewer catches up.
+void deimos_remote_pump(void);
+// Input from the viewer, in the same form input_poll returns. 1 if ev was set.
+int deimos_remote_poll_event(struct user_input_event *ev);
+
+void deimos_remote_get_stats(struct deimos_remote_stats *out);
+
+#endif
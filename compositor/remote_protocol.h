@@ -0,0 +1,38 @@
+#ifndef DEIMOS_COMPOSITOR_REMOTE_PROTOCOL_H
+#define DEIMOS_COMPOSITOR_REMOTE_PROTOCOL_H
+
+// Wire format of the remote display export (compositor/remote.c) and its
+// reference viewer (tools/remote_viewer.c). All integers are little endian.
+//
+// Server -> viewer:
+//   hello:       "DRMT", u32 version, u16 width, u16 height, u8 format
+//                (RENDER_FORMAT_*), u8 bytes per pixel
+//   FRAME_BEGIN: u8 type, u32 serial; updates follow until FRAME_END
+//   COPY:        u8 type, u16 src_x, src_y, w, h, dst_x, dst_y
+//                (applied in order, as an overlapping-safe move)
+//   RAW:         u8 type, u16 x, y, w, h, w*h pixels in the hello's format
+//   RLE:         u8 type, u16 x, y, w, h, then per row (u16 run, pixel)
+//                pairs whose runs sum to w
+//   FRAME_END:   u8 type, u32 serial
+//
+// Viewer -> server:
+//   ACK:     u8 type, u32 serial (the viewer has applied that frame)
+//   POINTER: u8 type, i16 x, i16 y, u8 buttons (bit 0 = left), u8 modifiers
+//   KEY:     u8 type, u8 key, u8 pressed, u8 modifiers, u16 scancode
+//
+// The server keeps at most one frame unacknowledged; damage presented in the
+// meantime is coalesced into the next frame.
+#define DEIMOS_REMOTE_MAGIC "DRMT"
+#define DEIMOS_REMOTE_VERSION 1
+
+#define DEIMOS_REMOTE_FRAME_BEGIN 1
+#define DEIMOS_REMOTE_COPY 2
+#define DEIMOS_REMOTE_RAW 3
+#define DEIMOS_REMOTE_RLE 4
+#define DEIMOS_REMOTE_FRAME_END 5
+
+#define DEIMOS_REMOTE_ACK 1
+#define DEIMOS_REMOTE_POINTER 2
+#define DEIMOS_REMOTE_KEY 3
+
+#endif
@@ -0,0 +1,72 @@
+#include "compositor/shared_state.h"
+#include "rendering/rendering.h"
+
+// compositor.mtc indexes these blocks with literals (SharedState and
+// publish_layout); a change here has to be made there too.
+_Static_assert(sizeof(struct mt_int_array) == 24 && sizeof(long) == 8, "mtc array<int> header is 3 words");
+_Static_assert(DEIMOS_MAX_WINDOWS == 16, "compositor.mtc caps windows at 16");
+_Static_assert(DEIMOS_SS_VERSION == 0 && DEIMOS_SS_SCREEN_W == 1 && DEIMOS_SS_SCREEN_H == 2 &&
+                   DEIMOS_SS_GAP == 3 && DEIMOS_SS_SPLIT_BIAS == 4 && DEIMOS_SS_SPLIT_FORCE == 5 &&
+                   DEIMOS_SS_FOCUS_ID == 6 && DEIMOS_SS_UI_SCALE == 9,
+               "compositor.mtc SharedState word offsets");
+_Static_assert(DEIMOS_SS_SPLIT_BASE == 16 && DEIMOS_SS_SPLIT_STRIDE == 8, "compositor.mtc split words");
+_Static_assert(DEIMOS_SS_WINDOW_BASE == 144 && DEIMOS_SS_WINDOW_STRIDE == 5, "compositor.mtc window words");
+_Static_assert(DEIMOS_RECT_OUT_STRIDE == 6 && DEIMOS_SPLIT_OUT_STRIDE == 8, "compositor.mtc output strides");
+
+static int g_words[DEIMOS_SS_WORDS];
+static struct mt_int_array g_block = { DEIMOS_SS_WORDS, DEIMOS_SS_WORDS, g_words };
+static int g_dirty;
+
+static void store_word(int index, int value) {
+    if (g_words[index] == value) return;
+    g_words[index] = value;
+    g_dirty = 1;
+}
+
+int deimos_shared_state_sync(const struct deimos_config *cfg) {
+    g_dirty = 0;
+
+    store_word(DEIMOS_SS_SCREEN_W, render_width());
+    store_word(DEIMOS_SS_SCREEN_H, render_height());
+    store_word(DEIMOS_SS_FOCUS_ID, deimos_focus_window_id());
+    store_word(DEIMOS_SS_UI_SCALE, render_ui_scale());
+    if (cfg) {
+        store_word(DEIMOS_SS_GAP, cfg->window_gap);
+        store_word(DEIMOS_SS_SPLIT_BIAS, cfg->split_vertical_bias_percent);
+        store_word(DEIMOS_SS_SPLIT_FORCE, cfg->split_force_mode);
+        store_word(DEIMOS_SS_WINDOW_COLOR, (int)cfg->window_border_color);
+        store_word(DEIMOS_SS_FOCUS_COLOR, (int)cfg->window_focus_color);
+    }
+
+    for (int i = 0; i < DEIMOS_MAX_WINDOWS; i++) {
+        int base = DEIMOS_SS_SPLIT_BASE + (i * DEIMOS_SS_SPLIT_STRIDE);
+        store_word(base + 0, deimos_split_x(i));
+        store_word(base + 1, deimos_split_y(i));
+        store_word(base + 2, deimos_split_target_mode(i));
+        store_word(base + 3, deimos_split_target_id(i));
+        store_word(base + 4, deimos_split_ratio(i));
+        store_word(base + 5, deimos_split_orient(i));
+        store_word(base + 6, deimos_split_side(i));
+        store_word(base + 7, deimos_split_pinned_target_id(i));
+
+        base = DEIMOS_SS_WINDOW_BASE + (i * DEIMOS_SS_WINDOW_STRIDE);
+        store_word(base + 0, deimos_window_floating(i));
+        store_word(base + 1, deimos_float_x(i));
+        store_word(base + 2, deimos_float_y(i));
+        store_word(base + 3, deimos_float_w(i));
+        store_word(base + 4, deimos_float_h(i));
+    }
+
+    if (g_dirty) {
+        g_words[DEIMOS_SS_VERSION]++;
+    }
+    return g_words[DEIMOS_SS_VERSION];
+}
+
+int deimos_shared_state_version(void) {
+    return g_words[DEIMOS_SS_VERSION];
+}
+
+struct mt_int_array *deimos_shared_state(void) {
+    return &g_block;
+}
@@ -0,0 +1,50 @@
+#ifndef DEIMOS_COMPOSITOR_SHARED_STATE_H
+#define DEIMOS_COMPOSITOR_SHARED_STATE_H
+
+#include "config.h"
+#include "window_manager/state.h"
+
+// Header layout of an mtc `array<int>` as the mt-lang compiler emits it
+// (length, capacity, data pointer); the ABI is the compiler's, mt_runtime.c
+// only backs its malloc. C-owned blocks use it so mt-lang can index them in
+// place.
+struct mt_int_array {
+    long length;
+    long capacity;
+    int *data;
+};
+
+// Word offsets into the shared state block. Mirrored by SharedState in
+// compositor/compositor.mtc as literal numbers; shared_state.c asserts the
+// values the mt-lang side hardcodes, so keep both sides in sync.
+#define DEIMOS_SS_VERSION            0
+#define DEIMOS_SS_SCREEN_W           1
+#define DEIMOS_SS_SCREEN_H           2
+#define DEIMOS_SS_GAP                3
+#define DEIMOS_SS_SPLIT_BIAS         4
+#define DEIMOS_SS_SPLIT_FORCE        5
+#define DEIMOS_SS_FOCUS_ID           6
+#define DEIMOS_SS_WINDOW_COLOR       7
+#define DEIMOS_SS_FOCUS_COLOR        8
+#define DEIMOS_SS_UI_SCALE           9
+#define DEIMOS_SS_SPLIT_BASE         16
+#define DEIMOS_SS_SPLIT_STRIDE       8   // x, y, target_mode, target_id, ratio, orient, side, pinned_target
+#define DEIMOS_SS_WINDOW_BASE        (DEIMOS_SS_SPLIT_BASE + (DEIMOS_MAX_WINDOWS * DEIMOS_SS_SPLIT_STRIDE))
+#define DEIMOS_SS_WINDOW_STRIDE      5   // floating, float x, y, w, h
+#define DEIMOS_SS_WORDS              (DEIMOS_SS_WINDOW_BASE + (DEIMOS_MAX_WINDOWS * DEIMOS_SS_WINDOW_STRIDE))
+
+// Flat layout output written by the compositor in one batch: id, x, y, w, h, floating.
+#define DEIMOS_RECT_OUT_STRIDE       6
+// Per-split output: target_index, orient, side, parent x, y, w, h, boundary.
+#define DEIMOS_SPLIT_OUT_STRIDE      8
+
+// Refreshes the block from config/WM/render state. The version word is bumped
+// only when some word actually changed, so readers can skip unchanged state.
+// Returns the current version.
+int deimos_shared_state_sync(const struct deimos_config *cfg);
+int deimos_shared_state_version(void);
+
+// Exposed for compositor.mtc extern calls.
+struct mt_int_array *deimos_shared_state(void);
+
+#endif
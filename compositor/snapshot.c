@@ -0,0 +1,307 @@
+#include "compositor/snapshot.h"
+#include "compositor/stacking.h"
+
+// Row encoding: a single 0 word repeats the previous row; otherwise the row is
+// a sequence of tokens whose pixel counts sum to the width:
+//   0x00nnnnnn            n pixels (n > 0) equal to the background image
+//   0xRRpppppp            RR (1..254) pixels of the 24-bit native value p
+//   0xFFnnnnnn, pixel     n pixels of a value wider than 24 bits, or a longer run
+// Pixels are stored in the framebuffer's native format. Against a wallpaper
+// only the windows cost words, and flat areas cost one word per run.
+#define SNAP_REPEAT_ROW 0U
+#define SNAP_LONG_RUN 0xFFU
+#define SNAP_MAX_SHORT_RUN 254
+
+struct snapshot_slot {
+    int valid;
+    int offset; // into g_pool
+    int words;
+    int width;
+    int height;
+    int bytes_per_pixel;
+    const uint8_t *background; // image skipped spans come from, or 0
+    uint32_t background_serial;
+    uint32_t last_used;
+    struct deimos_window_rect rects[DEIMOS_MAX_REPORT_WINDOWS];
+    int rect_count;
+    struct render_rect stale[DEIMOS_SNAPSHOT_MAX_STALE];
+    int stale_count;
+    int stale_full;
+};
+
+static uint32_t g_pool[DEIMOS_SNAPSHOT_POOL_WORDS];
+static int g_pool_used;
+static struct snapshot_slot g_slots[DEIMOS_SNAPSHOT_SLOTS];
+static uint32_t g_clock;
+
+static uint32_t load_pixel(const uint8_t *p, int bytes) {
+    if (bytes == 4) return *(const uint32_t *)p;
+    if (bytes == 3) return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return *(const uint16_t *)p;
+}
+
+static void store_pixel(uint8_t *p, int bytes, uint32_t v) {
+    if (bytes == 4) {
+        *(uint32_t *)p = v;
+    } else if (bytes == 3) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+    } else {
+        *(uint16_t *)p = (uint16_t)v;
+    }
+}
+
+static int rows_equal(const uint8_t *a, const uint8_t *b, int bytes) {
+    const uint32_t *wa = (const uint32_t *)a;
+    const uint32_t *wb = (const uint32_t *)b;
+    int n = bytes / 4;
+    for (int i = 0; i < n; i++) {
+        if (wa[i] != wb[i]) return 0;
+    }
+    for (int i = n * 4; i < bytes; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+// Pixels from p on (at most n) equal to the background at the same offset.
+static int background_span(const uint8_t *p, const uint8_t *bg, int n, int bytes) {
+    int i = 0;
+    while (i < n && load_pixel(p + i * bytes, bytes) == load_pixel(bg + i * bytes, bytes)) i++;
+    return i;
+}
+
+// Encodes row y of the backbuffer into out. Returns the word count, or -1
+// once more than `limit` words would be needed.
+static int encode_row(uint32_t *out, int limit, int y, const uint8_t *bg) {
+    const uint8_t *fb = render_backbuffer();
+    int w = render_width();
+    int bpp = render_bpp() / 8;
+    int pitch = render_pitch();
+    const uint8_t *row = fb + (long)y * pitch;
+    const uint8_t *bg_row = bg ? bg + (long)y * pitch : 0;
+    int n = 0;
+
+    if (y > 0 && rows_equal(row, row - pitch, w * bpp)) {
+        if (limit < 1) return -1;
+        out[0] = SNAP_REPEAT_ROW;
+        return 1;
+    }
+
+    int x = 0;
+    while (x < w) {
+        const uint8_t *p = row + x * bpp;
+        int skip = bg_row ? background_span(p, bg_row + x * bpp, w - x, bpp) : 0;
+        uint32_t px = load_pixel(p, bpp);
+        int run = 1;
+        while (x + run < w && run <= skip && load_pixel(p + run * bpp, bpp) == px) {
+            run++;
+        }
+        if (skip >= run) {
+            if (n + 1 > limit) return -1;
+            out[n++] = (uint32_t)skip;
+            x += skip;
+            continue;
+        }
+        while (x + run < w && load_pixel(p + run * bpp, bpp) == px) {
+            run++;
+        }
+        if (run <= SNAP_MAX_SHORT_RUN && (px >> 24) == 0) {
+            if (n + 1 > limit) return -1;
+            out[n++] = ((uint32_t)run << 24) | px;
+        } else {
+            if (n + 2 > limit) return -1;
+            out[n++] = (SNAP_LONG_RUN << 24) | (uint32_t)run;
+            out[n++] = px;
+        }
+        x += run;
+    }
+    return n;
+}
+
+static void decode_frame(const struct snapshot_slot *s) {
+    uint8_t *fb = render_backbuffer();
+    int bpp = s->bytes_per_pixel;
+    int pitch = render_pitch();
+    int row_bytes = s->width * bpp;
+    const uint32_t *in = &g_pool[s->offset];
+    const uint32_t *end = in + s->words;
+
+    for (int y = 0; y < s->height && in < end; y++) {
+        uint8_t *row = fb + (long)y * pitch;
+        if (*in == SNAP_REPEAT_ROW) {
+            const uint8_t *prev = row - pitch;
+            for (int i = 0; i < row_bytes; i++) {
+                row[i] = prev[i];
+            }
+            in++;
+            continue;
+        }
+
+        int x = 0;
+        while (x < s->width && in < end) {
+            uint32_t token = *in++;
+            uint32_t tag = token >> 24;
+            int run = (int)(token & 0x00FFFFFFU);
+            if (run > s->width - x) run = s->width - x;
+            if (tag == 0) {
+                const uint8_t *bg = s->background + (long)y * pitch + x * bpp;
+                for (int i = 0; i < run * bpp; i++) {
+                    row[x * bpp + i] = bg[i];
+                }
+                x += run;
+                continue;
+            }
+
+            uint32_t px = token & 0x00FFFFFFU;
+            if (tag == SNAP_LONG_RUN) {
+                if (in >= end) break;
+                px = *in++;
+            } else {
+                run = (int)tag;
+                if (run > s->width - x) run = s->width - x;
+            }
+            for (int i = 0; i < run; i++) {
+                store_pixel(row + (x + i) * bpp, bpp, px);
+            }
+            x += run;
+        }
+    }
+}
+
+static void release_slot(int slot) {
+    struct snapshot_slot *s = &g_slots[slot];
+    if (!s->valid) return;
+
+    // Compact: shift every later snapshot down over the freed words.
+    int start = s->offset;
+    int words = s->words;
+    for (int i = start + words; i < g_pool_used; i++) {
+        g_pool[i - words] = g_pool[i];
+    }
+    for (int i = 0; i < DEIMOS_SNAPSHOT_SLOTS; i++) {
+        if (g_slots[i].valid && g_slots[i].offset > start) {
+            g_slots[i].offset -= words;
+        }
+    }
+    g_pool_used -= words;
+    s->valid = 0;
+}
+
+static int evict_lru(int keep_a, int keep_b) {
+    int victim = -1;
+    for (int i = 0; i < DEIMOS_SNAPSHOT_SLOTS; i++) {
+        if (!g_slots[i].valid || i == keep_a || i == keep_b) continue;
+        if (victim < 0 || g_slots[i].last_used < g_slots[victim].last_used) {
+            victim = i;
+        }
+    }
+    if (victim < 0) return 0;
+    release_slot(victim);
+    return 1;
+}
+
+int deimos_snapshot_capture(int slot, int keep_slot, const struct render_rect *stale, int stale_count) {
+    if (slot < 0 || slot >= DEIMOS_SNAPSHOT_SLOTS) return 0;
+    if (!render_backbuffer()) return 0;
+
+    release_slot(slot);
+
+    // Rows are encoded straight into the free end of the pool; when a row does
+    // not fit, the least recently used snapshot is evicted (compaction moves
+    // this one down with the rest) and only that row is encoded again.
+    const uint8_t *bg = render_background();
+    struct snapshot_slot *s = &g_slots[slot];
+    s->valid = 1;
+    s->offset = g_pool_used;
+    s->words = 0;
+    for (int y = 0; y < render_height(); y++) {
+        int words = encode_row(&g_pool[g_pool_used], DEIMOS_SNAPSHOT_POOL_WORDS - g_pool_used, y, bg);
+        if (words < 0) {
+            if (!evict_lru(slot, keep_slot)) {
+                release_slot(slot);
+                return 0;
+            }
+            y--;
+            continue;
+        }
+        s->words += words;
+        g_pool_used += words;
+    }
+
+    s->width = render_width();
+    s->height = render_height();
+    s->bytes_per_pixel = render_bpp() / 8;
+    s->background = bg;
+    s->background_serial = render_background_serial();
+    s->last_used = ++g_clock;
+
+    s->rect_count = 0;
+    int count = deimos_layout_count();
+    for (int i = 0; i < count && i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
+        const struct deimos_window_rect *r = deimos_layout_rect_at(i);
+        if (!r) continue;
+        s->rects[s->rect_count++] = *r;
+    }
+
+    s->stale_full = render_is_full_dirty();
+    s->stale_count = 0;
+    for (int i = 0; i < stale_count && !s->stale_full; i++) {
+        if (s->stale_count >= DEIMOS_SNAPSHOT_MAX_STALE) {
+            s->stale_full = 1;
+            break;
+        }
+        s->stale[s->stale_count++] = stale[i];
+    }
+    if (!s->stale_full && render_has_dirty()) {
+        int room = DEIMOS_SNAPSHOT_MAX_STALE - s->stale_count;
+        if (render_dirty_count() > room) {
+            s->stale_full = 1;
+        } else {
+            s->stale_count += render_damage_clip(0, 0, s->width, s->height, &s->stale[s->stale_count], room);
+        }
+    }
+    return 1;
+}
+
+int deimos_snapshot_restore(int slot) {
+    if (slot < 0 || slot >= DEIMOS_SNAPSHOT_SLOTS) return 0;
+    struct snapshot_slot *s = &g_slots[slot];
+    if (!s->valid || !render_backbuffer()) return 0;
+
+    if (s->width != render_width() || s->height != render_height() ||
+        s->bytes_per_pixel != render_bpp() / 8 ||
+        (s->background && (s->background != render_background() ||
+                           s->background_serial != render_background_serial()))) {
+        release_slot(slot);
+        return 0;
+    }
+
+    decode_frame(s);
+    render_reset_dirty();
+    render_present_full();
+
+    deimos_layout_adopt(s->rects, s->rect_count);
+    deimos_stacking_adopt();
+
+    if (s->stale_full) {
+        render_mark_full_dirty();
+    } else {
+        for (int i = 0; i < s->stale_count; i++) {
+            render_mark_dirty_rect(s->stale[i].x, s->stale[i].y, s->stale[i].w, s->stale[i].h);
+        }
+    }
+
+    release_slot(slot);
+    return 1;
+}
+
+void deimos_snapshot_drop(int slot) {
+    if (slot < 0 || slot >= DEIMOS_SNAPSHOT_SLOTS) return;
+    release_slot(slot);
+}
+
+int deimos_snapshot_pool_used(void) {
+    return g_pool_used;
+}
@@ -0,0 +1,29 @@
+#ifndef DEIMOS_COMPOSITOR_SNAPSHOT_H
+#define DEIMOS_COMPOSITOR_SNAPSHOT_H
+
+#include "compositor/layout.h"
+#include "rendering/rendering.h"
+
+// Per-workspace frame snapshots. Leaving a workspace RLE-encodes its last
+// presented frame into a fixed pool, storing only what differs from the
+// background image (snapshot.c); returning to it presents the snapshot
+// at once and adopts the layout it was taken with, so only stale regions are
+// recomposed. Background snapshots share DEIMOS_SNAPSHOT_POOL_WORDS; the least
+// recently used ones are evicted when a new capture does not fit.
+#define DEIMOS_SNAPSHOT_SLOTS 8
+#define DEIMOS_SNAPSHOT_POOL_WORDS (1 << 20) // 4 MiB
+#define DEIMOS_SNAPSHOT_MAX_STALE 32
+
+// `stale` lists screen areas holding transient content (cursor, overlays) that
+// must be redrawn on restore; pending damage is recorded as well. Snapshots
+// for `keep_slot` are never evicted by this capture. Returns 1 if stored.
+int deimos_snapshot_capture(int slot, int keep_slot, const struct render_rect *stale, int stale_count);
+
+// Presents the snapshot, adopts its layout and marks its stale areas dirty.
+// The snapshot is released afterwards. Returns 0 if there was none.
+int deimos_snapshot_restore(int slot);
+
+void deimos_snapshot_drop(int slot);
+int deimos_snapshot_pool_used(void); // in words
+
+#endif
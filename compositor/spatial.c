@@ -0,0 +1,108 @@
+#include "compositor/spatial.h"
+
+static uint32_t g_cells[DEIMOS_SPATIAL_MAX_COLS * DEIMOS_SPATIAL_MAX_ROWS];
+static int g_cols;
+static int g_rows;
+static int g_screen_w;
+static int g_screen_h;
+
+// Converts a rect to an inclusive cell range; returns 0 when off-grid.
+static int cell_range(int x, int y, int w, int h, int *c0, int *r0, int *c1, int *r1) {
+    if (w <= 0 || h <= 0 || g_cols <= 0 || g_rows <= 0) return 0;
+
+    int x1 = x + w - 1;
+    int y1 = y + h - 1;
+    if (x1 < 0 || y1 < 0 || x >= g_screen_w || y >= g_screen_h) return 0;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 >= g_screen_w) x1 = g_screen_w - 1;
+    if (y1 >= g_screen_h) y1 = g_screen_h - 1;
+
+    *c0 = x >> DEIMOS_SPATIAL_CELL_SHIFT;
+    *r0 = y >> DEIMOS_SPATIAL_CELL_SHIFT;
+    *c1 = x1 >> DEIMOS_SPATIAL_CELL_SHIFT;
+    *r1 = y1 >> DEIMOS_SPATIAL_CELL_SHIFT;
+    if (*c1 >= g_cols) *c1 = g_cols - 1;
+    if (*r1 >= g_rows) *r1 = g_rows - 1;
+    return 1;
+}
+
+static void apply_rect(const struct render_rect *r, uint32_t bit, int set) {
+    int c0, r0, c1, r1;
+    if (!r || !cell_range(r->x, r->y, r->w, r->h, &c0, &r0, &c1, &r1)) return;
+
+    for (int row = r0; row <= r1; row++) {
+        uint32_t *cell = &g_cells[row * g_cols + c0];
+        for (int col = c0; col <= c1; col++, cell++) {
+            if (set) {
+                *cell |= bit;
+            } else {
+                *cell &= ~bit;
+            }
+        }
+    }
+}
+
+void deimos_spatial_init(int screen_w, int screen_h) {
+    g_screen_w = screen_w;
+    g_screen_h = screen_h;
+    g_cols = (screen_w + (1 << DEIMOS_SPATIAL_CELL_SHIFT) - 1) >> DEIMOS_SPATIAL_CELL_SHIFT;
+    g_rows = (screen_h + (1 << DEIMOS_SPATIAL_CELL_SHIFT) - 1) >> DEIMOS_SPATIAL_CELL_SHIFT;
+    if (g_cols > DEIMOS_SPATIAL_MAX_COLS) g_cols = DEIMOS_SPATIAL_MAX_COLS;
+    if (g_rows > DEIMOS_SPATIAL_MAX_ROWS) g_rows = DEIMOS_SPATIAL_MAX_ROWS;
+    if (g_cols < 0) g_cols = 0;
+    if (g_rows < 0) g_rows = 0;
+
+    for (int i = 0; i < g_cols * g_rows; i++) {
+        g_cells[i] = 0;
+    }
+}
+
+int deimos_spatial_ready(void) {
+    return g_cols > 0 && g_rows > 0;
+}
+
+void deimos_spatial_move(int window_id, const struct render_rect *old_rect, const struct render_rect *new_rect) {
+    if (window_id <= 0 || window_id >= 32) return;
+
+    uint32_t bit = 1U << window_id;
+    apply_rect(old_rect, bit, 0);
+    apply_rect(new_rect, bit, 1);
+}
+
+uint32_t deimos_spatial_point_mask(int x, int y) {
+    if (x < 0 || y < 0 || x >= g_screen_w || y >= g_screen_h) return 0;
+
+    int col = x >> DEIMOS_SPATIAL_CELL_SHIFT;
+    int row = y >> DEIMOS_SPATIAL_CELL_SHIFT;
+    if (col >= g_cols || row >= g_rows) return 0;
+    return g_cells[row * g_cols + col];
+}
+
+uint32_t deimos_spatial_rect_mask(int x, int y, int w, int h) {
+    int c0, r0, c1, r1;
+    if (!cell_range(x, y, w, h, &c0, &r0, &c1, &r1)) return 0;
+
+    uint32_t mask = 0;
+    for (int row = r0; row <= r1; row++) {
+        const uint32_t *cell = &g_cells[row * g_cols + c0];
+        for (int col = c0; col <= c1; col++, cell++) {
+            mask |= *cell;
+        }
+    }
+    return mask;
+}
+
+uint32_t deimos_spatial_damage_mask(void) {
+    if (render_is_full_dirty()) {
+        return deimos_spatial_rect_mask(0, 0, g_screen_w, g_screen_h);
+    }
+
+    struct render_rect damage[RENDER_MAX_DIRTY_RECTS];
+    int count = render_damage_clip(0, 0, g_screen_w, g_screen_h, damage, RENDER_MAX_DIRTY_RECTS);
+    uint32_t mask = 0;
+    for (int i = 0; i < count; i++) {
+        mask |= deimos_spatial_rect_mask(damage[i].x, damage[i].y, damage[i].w, damage[i].h);
+    }
+    return mask;
+}
@@ -0,0 +1,26 @@
+#ifndef DEIMOS_COMPOSITOR_SPATIAL_H
+#define DEIMOS_COMPOSITOR_SPATIAL_H
+
+#include <stdint.h>
+#include "rendering/rendering.h"
+
+// Uniform grid over the desktop (every output). Each cell holds a bitmask of
+// window ids (bit `id`, ids 1..31) whose rect overlaps it, so point hits and
+// rect/damage overlap queries only look at windows that can actually match.
+#define DEIMOS_SPATIAL_CELL_SHIFT 6 // 64x64 pixel cells
+#define DEIMOS_SPATIAL_MAX_COLS 128
+#define DEIMOS_SPATIAL_MAX_ROWS 128
+
+void deimos_spatial_init(int screen_w, int screen_h);
+int deimos_spatial_ready(void);
+
+// Incremental update for one window; old_rect/new_rect may be null when the
+// window appears or disappears.
+void deimos_spatial_move(int window_id, const struct render_rect *old_rect, const struct render_rect *new_rect);
+
+uint32_t deimos_spatial_point_mask(int x, int y);
+uint32_t deimos_spatial_rect_mask(int x, int y, int w, int h);
+// Windows whose cells touch any rect of the current damage region.
+uint32_t deimos_spatial_damage_mask(void);
+
+#endif
@@ -0,0 +1,230 @@
+#include "compositor/stacking.h"
+#include "compositor/spatial.h"
+#include "window_manager/state.h"
+
+struct stacking_entry {
+    struct deimos_window_rect rect;
+    struct deimos_region visible;
+};
+
+static struct stacking_entry g_stack[DEIMOS_MAX_REPORT_WINDOWS];
+static int g_stack_count;
+
+// Previous visible regions and rects, indexed by window id.
+static struct deimos_region g_prev_visible[DEIMOS_MAX_REPORT_WINDOWS + 1];
+static struct deimos_window_rect g_prev_rect[DEIMOS_MAX_REPORT_WINDOWS + 1];
+static int g_prev_valid[DEIMOS_MAX_REPORT_WINDOWS + 1];
+static int g_prev_slot[DEIMOS_MAX_REPORT_WINDOWS + 1];
+
+static int g_seen_layout_serial = -1;
+static int g_seen_stacking_serial = -1;
+static int g_hidden_window_id = -1;
+static int g_options_changed = 1;
+static int g_adopting = 0;
+static int g_floating_occludes = 1;
+
+static void stacking_push(const struct deimos_window_rect *r) {
+    if (!r || !r->valid || g_stack_count >= DEIMOS_MAX_REPORT_WINDOWS) return;
+    if (r->id == g_hidden_window_id) return;
+    g_stack[g_stack_count].rect = *r;
+    g_stack_count++;
+}
+
+static int rect_same(const struct deimos_window_rect *a, const struct deimos_window_rect *b) {
+    return a->x == b->x && a->y == b->y && a->w == b->w && a->h == b->h &&
+           a->floating == b->floating;
+}
+
+// Screen footprint: floating windows include their shadow margin.
+static void rect_to_render(const struct deimos_window_rect *r, struct render_rect *out) {
+    int m = r->floating ? deimos_layout_float_margin() : 0;
+    out->x = r->x - m;
+    out->y = r->y - m;
+    out->w = r->w + 2 * m;
+    out->h = r->h + 2 * m;
+}
+
+// Moves only the windows whose rect appeared, vanished or changed in the grid.
+static void sync_spatial_index(void) {
+    if (!deimos_spatial_ready()) {
+        deimos_spatial_init(render_desktop_width(), render_desktop_height());
+        for (int id = 0; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+            g_prev_valid[id] = 0;
+        }
+    }
+
+    int present[DEIMOS_MAX_REPORT_WINDOWS + 1];
+    for (int id = 0; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+        present[id] = 0;
+    }
+
+    for (int slot = 0; slot < g_stack_count; slot++) {
+        const struct deimos_window_rect *r = &g_stack[slot].rect;
+        int id = r->id;
+        if (id <= 0 || id > DEIMOS_MAX_REPORT_WINDOWS) continue;
+        present[id] = 1;
+
+        struct render_rect next;
+        rect_to_render(r, &next);
+        if (!g_prev_valid[id]) {
+            deimos_spatial_move(id, 0, &next);
+        } else if (!rect_same(&g_prev_rect[id], r)) {
+            struct render_rect prev;
+            rect_to_render(&g_prev_rect[id], &prev);
+            deimos_spatial_move(id, &prev, &next);
+        }
+    }
+
+    for (int id = 1; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+        if (g_prev_valid[id] && !present[id]) {
+            struct render_rect prev;
+            rect_to_render(&g_prev_rect[id], &prev);
+            deimos_spatial_move(id, &prev, 0);
+        }
+    }
+}
+
+static void mark_newly_exposed(const struct stacking_entry *e, int slot) {
+    int id = e->rect.id;
+    if (g_adopting) return;
+    if (id <= 0 || id > DEIMOS_MAX_REPORT_WINDOWS) return;
+
+    // New or previously hidden windows: nothing of them is on screen yet.
+    if (!g_prev_valid[id]) {
+        deimos_region_mark_dirty(&e->visible);
+        return;
+    }
+
+    // Moved/resized windows are fully damaged by the layout diff already.
+    if (!rect_same(&g_prev_rect[id], &e->rect)) return;
+
+    // A restacked floating window's shadow now falls on different windows.
+    if (e->rect.floating && slot != g_prev_slot[id] && deimos_layout_float_margin() > 0) {
+        struct render_rect footprint;
+        rect_to_render(&e->rect, &footprint);
+        render_mark_dirty_rect(footprint.x, footprint.y, footprint.w, footprint.h);
+    }
+
+    if (g_prev_visible[id].overflow) {
+        deimos_region_mark_dirty(&e->visible);
+        return;
+    }
+
+    struct deimos_region exposed;
+    deimos_region_copy(&exposed, &e->visible);
+    deimos_region_subtract(&exposed, &g_prev_visible[id]);
+    deimos_region_mark_dirty(&exposed);
+}
+
+int deimos_stacking_update(void) {
+    int layout_serial = deimos_layout_serial();
+    int stacking_serial = deimos_wm_stacking_serial();
+    if (layout_serial == g_seen_layout_serial &&
+        stacking_serial == g_seen_stacking_serial &&
+        !g_options_changed) {
+        return 0;
+    }
+    g_seen_layout_serial = layout_serial;
+    g_seen_stacking_serial = stacking_serial;
+    g_options_changed = 0;
+
+    for (int id = 0; id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+        g_prev_valid[id] = 0;
+    }
+    for (int slot = 0; slot < g_stack_count; slot++) {
+        int id = g_stack[slot].rect.id;
+        if (id <= 0 || id > DEIMOS_MAX_REPORT_WINDOWS) continue;
+        deimos_region_copy(&g_prev_visible[id], &g_stack[slot].visible);
+        g_prev_rect[id] = g_stack[slot].rect;
+        g_prev_valid[id] = 1;
+        g_prev_slot[id] = slot;
+    }
+
+    g_stack_count = 0;
+    int count = deimos_layout_count();
+    for (int i = 0; i < count; i++) {
+        const struct deimos_window_rect *r = deimos_layout_rect_at(i);
+        if (r && !r->floating) {
+            stacking_push(r);
+        }
+    }
+    int z_count = deimos_wm_z_count();
+    for (int slot = 0; slot < z_count; slot++) {
+        const struct deimos_window_rect *r = deimos_layout_find(deimos_wm_z_window_id(slot));
+        if (r && r->floating) {
+            stacking_push(r);
+        }
+    }
+    sync_spatial_index();
+
+    for (int slot = 0; slot < g_stack_count; slot++) {
+        struct stacking_entry *e = &g_stack[slot];
+        deimos_region_set_rect(&e->visible, e->rect.x, e->rect.y, e->rect.w, e->rect.h);
+        for (int above = slot + 1; above < g_stack_count; above++) {
+            if (g_stack[above].rect.floating && !g_floating_occludes) continue;
+            struct render_rect cut;
+            cut.x = g_stack[above].rect.x;
+            cut.y = g_stack[above].rect.y;
+            cut.w = g_stack[above].rect.w;
+            cut.h = g_stack[above].rect.h;
+            deimos_region_subtract_rect(&e->visible, &cut);
+        }
+        mark_newly_exposed(e, slot);
+    }
+
+    return 1;
+}
+
+void deimos_stacking_adopt(void) {
+    g_seen_layout_serial = -1;
+    g_adopting = 1;
+    deimos_stacking_update();
+    g_adopting = 0;
+}
+
+void deimos_stacking_set_floating_occludes(int occludes) {
+    occludes = occludes ? 1 : 0;
+    if (occludes == g_floating_occludes) return;
+    g_floating_occludes = occludes;
+    g_options_changed = 1;
+}
+
+void deimos_stacking_set_hidden(int window_id) {
+    if (window_id == g_hidden_window_id) return;
+    g_hidden_window_id = window_id;
+    g_options_changed = 1;
+}
+
+int deimos_stacking_count(void) {
+    return g_stack_count;
+}
+
+int deimos_stacking_window_id(int slot) {
+    if (slot < 0 || slot >= g_stack_count) return -1;
+    return g_stack[slot].rect.id;
+}
+
+const struct deimos_window_rect *deimos_stacking_rect(int slot) {
+    if (slot < 0 || slot >= g_stack_count) return 0;
+    return &g_stack[slot].rect;
+}
+
+const struct deimos_region *deimos_stacking_visible(int slot) {
+    if (slot < 0 || slot >= g_stack_count) return 0;
+    return &g_stack[slot].visible;
+}
+
+int deimos_stacking_hit_test(int x, int y) {
+    uint32_t candidates = deimos_spatial_point_mask(x, y);
+    if (!candidates) return -1;
+
+    for (int slot = g_stack_count - 1; slot >= 0; slot--) {
+        const struct deimos_window_rect *r = &g_stack[slot].rect;
+        if (r->id <= 0 || !(candidates & (1U << r->id))) continue;
+        if (r->w <= 0 || r->h <= 0) continue;
+        if (x >= r->x && y >= r->y && x < r->x + r->w && y < r->y + r->h) {
+            return r->id;
+        }
+    }
+    return -1;
+}
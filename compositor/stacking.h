@@ -0,0 +1,31 @@
+#ifndef DEIMOS_COMPOSITOR_STACKING_H
+#define DEIMOS_COMPOSITOR_STACKING_H
+
+#include "compositor/layout.h"
+#include "compositor/region.h"
+
+// Draw/hit-test order: tiles in layout order at the bottom, then floating
+// windows in WM z order. Each window's visible region (its rect minus every
+// window stacked above it) is recomputed only when the published layout, the
+// WM stacking serial or the hidden window changes; areas that became visible
+// on windows that did not move are marked dirty. Returns 1 if recomputed.
+int deimos_stacking_update(void);
+
+// Recomputes the order and visible regions for a frame that is already on
+// screen (a restored snapshot): nothing is marked dirty.
+void deimos_stacking_adopt(void);
+
+// Translucent floating windows must not hide what is beneath them.
+void deimos_stacking_set_floating_occludes(int occludes);
+
+// Excludes a window (e.g. the one being dragged) from drawing and occlusion.
+void deimos_stacking_set_hidden(int window_id);
+
+int deimos_stacking_count(void);
+int deimos_stacking_window_id(int slot); // bottom to top
+const struct deimos_window_rect *deimos_stacking_rect(int slot);
+const struct deimos_region *deimos_stacking_visible(int slot);
+// Topmost window at (x, y); only windows indexed in that grid cell are tested.
+int deimos_stacking_hit_test(int x, int y);
+
+#endif
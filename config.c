@@ -1,4 +1,5 @@
 #include "config.h"
+#include "trace.h"
 #include <libsys.h>
 
 static int is_space(char c) {
@@ -149,6 +150,77 @@ static int parse_drag_preview_mode(const char *text, int *out_mode) {
     return 0;
 }
 
+static int parse_wallpaper_mode(const char *text, int *out_mode) {
+    if (!text || !out_mode) return 0;
+    if (str_eq(text, "stretch")) {
+        *out_mode = 0;
+        return 1;
+    }
+    if (str_eq(text, "tile")) {
+        *out_mode = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_trace_format(const char *text, int *out_format) {
+    if (!text || !out_format) return 0;
+    if (str_eq(text, "binary")) {
+        *out_format = DEIMOS_TRACE_FORMAT_BINARY;
+        return 1;
+    }
+    if (str_eq(text, "chrome")) {
+        *out_format = DEIMOS_TRACE_FORMAT_CHROME;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_decimal(const char *text, int *idx, int *out_value) {
+    int value = 0;
+    int start = *idx;
+    while (text[*idx] >= '0' && text[*idx] <= '9' && value < 100000) {
+        value = value * 10 + (text[*idx] - '0');
+        (*idx)++;
+    }
+    *out_value = value;
+    return *idx > start;
+}
+
+// "WxH" or "WxH@bpp" (bpp 16, 24 or 32; default 32).
+static int parse_output_mode(const char *text, struct deimos_virtual_output *out) {
+    if (!text || !out) return 0;
+
+    int idx = 0;
+    int width;
+    int height;
+    int bpp = 32;
+    if (!parse_decimal(text, &idx, &width) || (text[idx] != 'x' && text[idx] != 'X')) return 0;
+    idx++;
+    if (!parse_decimal(text, &idx, &height)) return 0;
+    if (text[idx] == '@') {
+        idx++;
+        if (!parse_decimal(text, &idx, &bpp)) return 0;
+    }
+    if (text[idx] != '\0') return 0;
+    if (width < 64 || height < 64 || width > 4096 || height > 4096) return 0;
+    if (bpp != 16 && bpp != 24 && bpp != 32) return 0;
+
+    out->width = width;
+    out->height = height;
+    out->bpp = bpp;
+    return 1;
+}
+
+static void copy_string(char *out, int out_size, const char *text) {
+    int i = 0;
+    while (text[i] && i < out_size - 1) {
+        out[i] = text[i];
+        i++;
+    }
+    out[i] = '\0';
+}
+
 static int parse_key(const char *text, char *out_key) {
     if (!text || !out_key) return 0;
     if (!text[0]) return 0;
@@ -177,6 +249,9 @@ void deimos_config_set_defaults(struct deimos_config *cfg) {
 
     cfg->key_new_window = 'n';
     cfg->key_quit = 'x';
+    cfg->key_toggle_float = 'f';
+    cfg->key_next_workspace = 'w';
+    cfg->key_next_output = 'o';
     cfg->mouse_new_window = 0;
     cfg->mouse_focus_follows_hover = 1;
     cfg->keyboard_split_use_focus = 1;
@@ -184,6 +259,8 @@ void deimos_config_set_defaults(struct deimos_config *cfg) {
     cfg->drag_preview_mode = 0;
 
     cfg->background_color = 0x101820;
+    cfg->wallpaper_path[0] = '\0';
+    cfg->wallpaper_mode = 0;
     cfg->cursor_color = 0xFFFFFF;
     cfg->fps_fg_color = 0xE6E6E6;
     cfg->fps_bg_color = 0x000000;
@@ -193,6 +270,24 @@ void deimos_config_set_defaults(struct deimos_config *cfg) {
     cfg->window_gap = 6;
     cfg->split_vertical_bias_percent = 160;
     cfg->split_force_mode = 0;
+    cfg->anim_duration_ms = 150;
+    cfg->governor_target_fps = 60;
+    cfg->shadow_radius = 12;
+    cfg->shadow_opacity_percent = 45;
+    cfg->float_opacity_percent = 100;
+    cfg->dither_rgb565 = 1;
+    cfg->present_buffers = 2;
+    cfg->ui_scale = 1;
+    cfg->full_repaint_interval = 0;
+    cfg->damage_verify = 0;
+    cfg->overdraw_debug = 0;
+    cfg->virtual_output_count = 0;
+    cfg->capture_path[0] = '\0';
+    cfg->capture_keyframe_interval = 300;
+    cfg->remote_out_path[0] = '\0';
+    cfg->remote_in_path[0] = '\0';
+    cfg->trace_path[0] = '\0';
+    cfg->trace_format = DEIMOS_TRACE_FORMAT_BINARY;
 }
 
 int deimos_config_load(struct deimos_config *cfg, const char *path) {
@@ -244,6 +339,12 @@ int deimos_config_load(struct deimos_config *cfg, const char *path) {
             if (parse_key(value, &key_value)) cfg->key_new_window = key_value;
         } else if (str_eq(key, "key_quit")) {
             if (parse_key(value, &key_value)) cfg->key_quit = key_value;
+        } else if (str_eq(key, "key_toggle_float")) {
+            if (parse_key(value, &key_value)) cfg->key_toggle_float = key_value;
+        } else if (str_eq(key, "key_next_workspace")) {
+            if (parse_key(value, &key_value)) cfg->key_next_workspace = key_value;
+        } else if (str_eq(key, "key_next_output")) {
+            if (parse_key(value, &key_value)) cfg->key_next_output = key_value;
         } else if (str_eq(key, "mouse_new_window")) {
             if (parse_bool(value, &int_value)) cfg->mouse_new_window = int_value;
         } else if (str_eq(key, "mouse_focus_follows_hover")) {
@@ -256,6 +357,10 @@ int deimos_config_load(struct deimos_config *cfg, const char *path) {
             if (parse_drag_preview_mode(value, &int_value)) cfg->drag_preview_mode = int_value;
         } else if (str_eq(key, "background_color")) {
             if (parse_u32(value, &u32_value)) cfg->background_color = u32_value;
+        } else if (str_eq(key, "wallpaper")) {
+            copy_string(cfg->wallpaper_path, (int)sizeof(cfg->wallpaper_path), value);
+        } else if (str_eq(key, "wallpaper_mode")) {
+            if (parse_wallpaper_mode(value, &int_value)) cfg->wallpaper_mode = int_value;
         } else if (str_eq(key, "cursor_color")) {
             if (parse_u32(value, &u32_value)) cfg->cursor_color = u32_value;
         } else if (str_eq(key, "fps_fg_color")) {
@@ -272,6 +377,45 @@ int deimos_config_load(struct deimos_config *cfg, const char *path) {
             if (parse_u32(value, &u32_value)) cfg->split_vertical_bias_percent = (int)u32_value;
         } else if (str_eq(key, "split_force_mode")) {
             if (parse_split_force_mode(value, &int_value)) cfg->split_force_mode = int_value;
+        } else if (str_eq(key, "anim_duration_ms")) {
+            if (parse_u32(value, &u32_value)) cfg->anim_duration_ms = (int)u32_value;
+        } else if (str_eq(key, "governor_target_fps")) {
+            if (parse_u32(value, &u32_value)) cfg->governor_target_fps = (int)u32_value;
+        } else if (str_eq(key, "shadow_radius")) {
+            if (parse_u32(value, &u32_value)) cfg->shadow_radius = (int)u32_value;
+        } else if (str_eq(key, "shadow_opacity_percent")) {
+            if (parse_u32(value, &u32_value)) cfg->shadow_opacity_percent = (int)u32_value;
+        } else if (str_eq(key, "float_opacity_percent")) {
+            if (parse_u32(value, &u32_value)) cfg->float_opacity_percent = (int)u32_value;
+        } else if (str_eq(key, "dither_rgb565")) {
+            if (parse_bool(value, &int_value)) cfg->dither_rgb565 = int_value;
+        } else if (str_eq(key, "present_buffers")) {
+            if (parse_u32(value, &u32_value)) cfg->present_buffers = (int)u32_value;
+        } else if (str_eq(key, "ui_scale")) {
+            if (parse_u32(value, &u32_value)) cfg->ui_scale = (int)u32_value;
+        } else if (str_eq(key, "full_repaint_interval")) {
+            if (parse_u32(value, &u32_value)) cfg->full_repaint_interval = (int)u32_value;
+        } else if (str_eq(key, "damage_verify")) {
+            if (parse_bool(value, &int_value)) cfg->damage_verify = int_value;
+        } else if (str_eq(key, "overdraw_debug")) {
+            if (parse_u32(value, &u32_value)) cfg->overdraw_debug = (int)u32_value;
+        } else if (str_eq(key, "virtual_output")) {
+            if (cfg->virtual_output_count < DEIMOS_MAX_VIRTUAL_OUTPUTS &&
+                parse_output_mode(value, &cfg->virtual_outputs[cfg->virtual_output_count])) {
+                cfg->virtual_output_count++;
+            }
+        } else if (str_eq(key, "capture")) {
+            copy_string(cfg->capture_path, (int)sizeof(cfg->capture_path), value);
+        } else if (str_eq(key, "capture_keyframe_interval")) {
+            if (parse_u32(value, &u32_value)) cfg->capture_keyframe_interval = (int)u32_value;
+        } else if (str_eq(key, "remote_out")) {
+            copy_string(cfg->remote_out_path, (int)sizeof(cfg->remote_out_path), value);
+        } else if (str_eq(key, "remote_in")) {
+            copy_string(cfg->remote_in_path, (int)sizeof(cfg->remote_in_path), value);
+        } else if (str_eq(key, "trace")) {
+            copy_string(cfg->trace_path, (int)sizeof(cfg->trace_path), value);
+        } else if (str_eq(key, "trace_format")) {
+            if (parse_trace_format(value, &int_value)) cfg->trace_format = int_value;
         }
     }
 
@@ -280,6 +424,22 @@ int deimos_config_load(struct deimos_config *cfg, const char *path) {
     if (cfg->split_vertical_bias_percent < 50) cfg->split_vertical_bias_percent = 50;
     if (cfg->split_vertical_bias_percent > 400) cfg->split_vertical_bias_percent = 400;
     if (cfg->split_force_mode < 0 || cfg->split_force_mode > 2) cfg->split_force_mode = 0;
+    if (cfg->anim_duration_ms < 0) cfg->anim_duration_ms = 0;
+    if (cfg->anim_duration_ms > 2000) cfg->anim_duration_ms = 2000;
+    if (cfg->governor_target_fps < 0) cfg->governor_target_fps = 0;
+    if (cfg->governor_target_fps > 240) cfg->governor_target_fps = 240;
+    if (cfg->shadow_radius < 0) cfg->shadow_radius = 0;
+    if (cfg->shadow_radius > 64) cfg->shadow_radius = 64;
+    if (cfg->shadow_opacity_percent < 0) cfg->shadow_opacity_percent = 0;
+    if (cfg->shadow_opacity_percent > 100) cfg->shadow_opacity_percent = 100;
+    if (cfg->float_opacity_percent < 10) cfg->float_opacity_percent = 10;
+    if (cfg->float_opacity_percent > 100) cfg->float_opacity_percent = 100;
+    if (cfg->present_buffers < 1) cfg->present_buffers = 1;
+    if (cfg->present_buffers > 3) cfg->present_buffers = 3;
+    if (cfg->ui_scale < 1) cfg->ui_scale = 1;
+    if (cfg->ui_scale > 3) cfg->ui_scale = 3;
+    if (cfg->overdraw_debug > 3) cfg->overdraw_debug = 3;
+    if (cfg->capture_keyframe_interval < 1) cfg->capture_keyframe_interval = 1;
     if (cfg->drag_modifier_mask < 0 || cfg->drag_modifier_mask > (MOD_SHIFT | MOD_CTRL | MOD_ALT | MOD_SUPER)) {
         cfg->drag_modifier_mask = MOD_SUPER;
     }
@@ -3,9 +3,20 @@
 
 #include <stdint.h>
 
+#define DEIMOS_MAX_VIRTUAL_OUTPUTS 3
+
+struct deimos_virtual_output {
+    int width;
+    int height;
+    int bpp;
+};
+
 struct deimos_config {
     char key_new_window;
     char key_quit;
+    char key_toggle_float;
+    char key_next_workspace;
+    char key_next_output;
     int mouse_new_window;
     int mouse_focus_follows_hover;
     int keyboard_split_use_focus;
@@ -13,6 +24,8 @@ struct deimos_config {
     int drag_preview_mode; // 0=full, 1=outline
 
     uint32_t background_color;
+    char wallpaper_path[64]; // PPM (P6) or QOI under /cfg; empty = flat background_color
+    int wallpaper_mode; // 0=stretch, 1=tile
     uint32_t cursor_color;
     uint32_t fps_fg_color;
     uint32_t fps_bg_color;
@@ -22,6 +35,26 @@ struct deimos_config {
     int window_gap;
     int split_vertical_bias_percent;
     int split_force_mode; // 0=auto, 1=vertical(left/right), 2=horizontal(top/bottom)
+    int anim_duration_ms; // layout transitions; 0 disables
+    int governor_target_fps; // quality governor frame budget; 0 disables
+    int shadow_radius; // floating window drop shadows; 0 disables
+    int shadow_opacity_percent;
+    int float_opacity_percent; // below 100 floating windows are translucent
+    int dither_rgb565; // ordered dithering when surfaces convert to 16 bpp
+    int present_buffers; // 1 = synchronous, 2 = double, 3 = triple buffering
+    int ui_scale; // integer HiDPI factor 1..3 for text, cursor, decorations and layout margins
+    int full_repaint_interval; // presented frames between forced full repaints; 0 disables
+    int damage_verify; // check every frame against a full repaint and report mismatches
+    int overdraw_debug; // 0 off, 1 HUD stats, 2 + write-count heatmap, 3 + present rect outlines
+    // In-memory outputs right of the framebuffer ("virtual_output = WxH[@bpp]").
+    struct deimos_virtual_output virtual_outputs[DEIMOS_MAX_VIRTUAL_OUTPUTS];
+    int virtual_output_count;
+    char capture_path[64]; // damage-driven screen recording; empty disables
+    int capture_keyframe_interval; // recorded frames between full-screen keyframes
+    char remote_out_path[64]; // remote display stream to a viewer; empty disables
+    char remote_in_path[64]; // viewer acks and input; empty sends unthrottled
+    char trace_path[64]; // event trace; empty disables
+    int trace_format; // DEIMOS_TRACE_FORMAT_*: binary (tools/trace_decode) or Chrome JSON
 };
 
 void deimos_config_set_defaults(struct deimos_config *cfg);
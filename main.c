@@ -1,40 +1,49 @@
 #include "config.h"
+#include "compositor/animation.h"
+#include "compositor/client.h"
+#include "compositor/damage_verify.h"
+#include "compositor/governor.h"
+#include "compositor/layout.h"
+#include "compositor/remote.h"
+#include "compositor/snapshot.h"
+#include "compositor/spatial.h"
+#include "compositor/stacking.h"
+#include "rendering/alpha.h"
+#include "rendering/capture.h"
+#include "rendering/convert.h"
 #include "rendering/rendering.h"
+#include "rendering/wallpaper.h"
+#include "trace.h"
+#include "util.h"
+#include "window_manager/input_queue.h"
 #include "window_manager/state.h"
 #include <libsys.h>
 
-extern int deimos_compositor_test_frame_with_count(int window_count);
-extern void mt_heap_reset(void);
-
 static struct deimos_config g_cfg;
 
-#define DEIMOS_MAX_REPORT_WINDOWS 16
 #define DEIMOS_SURFACE_W 48
 #define DEIMOS_SURFACE_H 32
+#define DEIMOS_SPAN_CHUNK 64
+// Pixels of queued frames copied out per pump; two pumps run per iteration.
+#define DEIMOS_PRESENT_SLICE_PIXELS (1 << 16)
 
-struct deimos_window_rect {
-    int id;
-    int x;
-    int y;
-    int w;
-    int h;
-    int valid;
-};
-
-static struct deimos_window_rect g_prev_window_rects[DEIMOS_MAX_REPORT_WINDOWS];
-static struct deimos_window_rect g_curr_window_rects[DEIMOS_MAX_REPORT_WINDOWS];
-static int g_prev_window_rect_count;
-static int g_curr_window_rect_count;
-static int g_should_draw_windows = 1;
 static int g_drag_active = 0;
 static int g_drag_window_id = -1;
 
+// Built-in window content is produced by an in-process client: it authors
+// each surface in XRGB once, converts it into a client buffer in the
+// framebuffer's format and commits it, so opaque draws are plain copies.
+// Windows another client attached to show that client's buffer instead.
 struct deimos_window_surface {
     int initialized;
-    uint32_t pixels[DEIMOS_SURFACE_W * DEIMOS_SURFACE_H];
+    int buffer;          // built-in client buffer id
+    uint32_t average;    // flat stand-in when the governor drops surface detail
+    uint32_t workspaces; // bit per workspace whose window `id` shows the buffer
 };
 
 static struct deimos_window_surface g_surfaces[DEIMOS_MAX_REPORT_WINDOWS + 1];
+static uint32_t g_surface_pixels[DEIMOS_SURFACE_W * DEIMOS_SURFACE_H];
+static int g_builtin_client = -1;
 
 static uint32_t colour_rgb(int r, int g, int b) {
     if (r < 0) r = 0;
@@ -46,11 +55,81 @@ static uint32_t colour_rgb(int r, int g, int b) {
     return ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
 }
 
+static uint32_t load_native(const uint8_t *p, int bytes) {
+    if (bytes == 2) return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+    if (bytes == 3) return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return *(const uint32_t *)p;
+}
+
+static void store_native(uint8_t *p, int bytes, uint32_t v) {
+    if (bytes == 4) {
+        *(uint32_t *)p = v;
+        return;
+    }
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    if (bytes == 3) p[2] = (uint8_t)((v >> 16) & 0xFF);
+}
+
+// Texel (sx, sy) of a client buffer in the framebuffer's format; buffers
+// already in that format (the common case) are read without conversion.
+static uint32_t buffer_texel_native(const struct deimos_client_buffer *b, int sx, int sy) {
+    const uint8_t *p = b->data + sy * b->stride + sx * b->bytes_per_pixel;
+    if (b->format == render_format()) return load_native(p, b->bytes_per_pixel);
+    return render_native_colour(render_unpack_pixel(b->format, p));
+}
+
+static uint32_t buffer_texel_xrgb(const struct deimos_client_buffer *b, int sx, int sy) {
+    return render_unpack_pixel(b->format, b->data + sy * b->stride + sx * b->bytes_per_pixel);
+}
+
+// Decorations grow with the UI scale: borders are one scale unit thick
+// (deimos_layout_border) and the title strip is 12 units tall (half the
+// interior on small windows).
+static int decor_strip_height(int inner_h) {
+    int s = render_ui_scale();
+    return (inner_h > 14 * s) ? 12 * s : (inner_h / 2);
+}
+
+// Conversion runs once per content change; draws never convert texels again.
+static void convert_window_surface(struct deimos_window_surface *s) {
+    if (g_builtin_client < 0) {
+        g_builtin_client = deimos_client_connect();
+    }
+    if (s->buffer <= 0) {
+        s->buffer = deimos_client_buffer_create(g_builtin_client, DEIMOS_SURFACE_W, DEIMOS_SURFACE_H, render_format());
+    }
+    uint8_t *data = deimos_client_buffer_map(g_builtin_client, s->buffer);
+    if (!data) return;
+
+    int stride = DEIMOS_SURFACE_W * render_format_bytes(render_format());
+    for (int y = 0; y < DEIMOS_SURFACE_H; y++) {
+        render_convert_span(render_format(), &data[y * stride], &g_surface_pixels[y * DEIMOS_SURFACE_W],
+                            DEIMOS_SURFACE_W, g_cfg.dither_rgb565, 0, y);
+    }
+}
+
+// Window ids repeat across workspaces and built-in content depends on the id
+// only, so every workspace's window `id` shows the same buffer; it is
+// attached on a workspace the first time the window is drawn there.
+static void attach_window_surface(int window_id, struct deimos_window_surface *s) {
+    int ws = deimos_wm_workspace();
+    if (s->buffer <= 0 || (s->workspaces & (1U << ws))) return;
+
+    deimos_client_attach(g_builtin_client, ws, window_id, s->buffer);
+    deimos_client_damage(g_builtin_client, ws, window_id, 0, 0, DEIMOS_SURFACE_W, DEIMOS_SURFACE_H);
+    deimos_client_commit(g_builtin_client, ws, window_id);
+    s->workspaces |= 1U << ws;
+}
+
 static void init_window_surface(int window_id) {
     if (window_id <= 0 || window_id > DEIMOS_MAX_REPORT_WINDOWS) return;
 
     struct deimos_window_surface *s = &g_surfaces[window_id];
-    if (s->initialized) return;
+    if (s->initialized) {
+        attach_window_surface(window_id, s);
+        return;
+    }
 
     int base_r = 40 + ((window_id * 53) % 120);
     int base_g = 60 + ((window_id * 31) % 120);
@@ -65,7 +144,7 @@ static void init_window_surface(int window_id) {
             int r = base_r + glow + checker;
             int g = base_g + (shade / 2) + checker;
             int b = base_b + shade - checker;
-            s->pixels[idx] = colour_rgb(r, g, b);
+            g_surface_pixels[idx] = colour_rgb(r, g, b);
         }
     }
 
@@ -74,103 +153,168 @@ static void init_window_surface(int window_id) {
     int tile_y = 4 + ((window_id * 5) % 12);
     for (int y = tile_y; y < tile_y + 8 && y < DEIMOS_SURFACE_H; y++) {
         for (int x = tile_x; x < tile_x + 14 && x < DEIMOS_SURFACE_W; x++) {
-            s->pixels[y * DEIMOS_SURFACE_W + x] = colour_rgb(230, 230, 240);
+            g_surface_pixels[y * DEIMOS_SURFACE_W + x] = colour_rgb(230, 230, 240);
         }
     }
 
+    uint32_t sum_r = 0;
+    uint32_t sum_g = 0;
+    uint32_t sum_b = 0;
+    for (int i = 0; i < DEIMOS_SURFACE_W * DEIMOS_SURFACE_H; i++) {
+        sum_r += (g_surface_pixels[i] >> 16) & 0xFF;
+        sum_g += (g_surface_pixels[i] >> 8) & 0xFF;
+        sum_b += g_surface_pixels[i] & 0xFF;
+    }
+    int n = DEIMOS_SURFACE_W * DEIMOS_SURFACE_H;
+    s->average = colour_rgb((int)(sum_r / n), (int)(sum_g / n), (int)(sum_b / n));
+    convert_window_surface(s);
+    attach_window_surface(window_id, s);
+
     s->initialized = 1;
 }
 
 static void deimos_draw_window_surface_full(int window_id, int x, int y, int w, int h, int focused) {
     if (window_id <= 0 || window_id > DEIMOS_MAX_REPORT_WINDOWS) return;
-    if (w <= 2 || h <= 2) return;
+    int bw = deimos_layout_border();
+    if (w <= 2 * bw || h <= 2 * bw) return;
 
     init_window_surface(window_id);
     struct deimos_window_surface *s = &g_surfaces[window_id];
     if (!s->initialized) return;
 
-    int inner_x = x + 1;
-    int inner_y = y + 1;
-    int inner_w = w - 2;
-    int inner_h = h - 2;
+    int inner_x = x + bw;
+    int inner_y = y + bw;
+    int inner_w = w - 2 * bw;
+    int inner_h = h - 2 * bw;
     if (inner_w <= 0 || inner_h <= 0) return;
 
-    for (int sy = 0; sy < DEIMOS_SURFACE_H; sy++) {
-        int y0 = inner_y + (sy * inner_h) / DEIMOS_SURFACE_H;
-        int y1 = inner_y + ((sy + 1) * inner_h) / DEIMOS_SURFACE_H;
-        if (y1 <= y0) continue;
+    int detail = focused || deimos_gov_allows(DEIMOS_GOV_SURFACE_DETAIL);
+    int strip_h = decor_strip_height(inner_h);
+    if (!focused && !deimos_gov_allows(DEIMOS_GOV_DECORATIONS)) strip_h = 0;
 
-        for (int sx = 0; sx < DEIMOS_SURFACE_W; sx++) {
-            int x0 = inner_x + (sx * inner_w) / DEIMOS_SURFACE_W;
-            int x1 = inner_x + ((sx + 1) * inner_w) / DEIMOS_SURFACE_W;
-            if (x1 <= x0) continue;
-
-            uint32_t c = s->pixels[sy * DEIMOS_SURFACE_W + sx];
-            render_fill_rect(x0, y0, x1 - x0, y1 - y0, c);
+    const struct deimos_client_buffer *b = deimos_client_window_buffer(window_id);
+    if (!detail || !b) {
+        render_fill_rect_native(inner_x, inner_y, inner_w, inner_h, render_native_colour(s->average));
+    } else {
+        // Texel (sx, sy) covers the screen pixels that sample it.
+        for (int sy = 0; sy < b->height; sy++) {
+            int y0 = inner_y + (sy * inner_h + b->height - 1) / b->height;
+            int y1 = inner_y + ((sy + 1) * inner_h + b->height - 1) / b->height;
+            if (y1 <= y0) continue;
+
+            for (int sx = 0; sx < b->width; sx++) {
+                int x0 = inner_x + (sx * inner_w + b->width - 1) / b->width;
+                int x1 = inner_x + ((sx + 1) * inner_w + b->width - 1) / b->width;
+                if (x1 <= x0) continue;
+
+                render_fill_rect_native(x0, y0, x1 - x0, y1 - y0, buffer_texel_native(b, sx, sy));
+            }
         }
     }
 
     // Simple title strip to make content feel like a real surface.
-    int strip_h = (inner_h > 14) ? 12 : (inner_h / 2);
     if (strip_h > 0) {
         uint32_t strip_col = focused ? colour_rgb(245, 245, 250) : colour_rgb(28, 32, 40);
         render_fill_rect(inner_x, inner_y, inner_w, strip_h, strip_col);
     }
 }
 
-static int clip_intersection(int ax, int ay, int aw, int ah,
-                             int bx, int by, int bw, int bh,
-                             int *ox, int *oy, int *ow, int *oh) {
-    int x0 = (ax > bx) ? ax : bx;
-    int y0 = (ay > by) ? ay : by;
-    int x1 = ((ax + aw) < (bx + bw)) ? (ax + aw) : (bx + bw);
-    int y1 = ((ay + ah) < (by + bh)) ? (ay + ah) : (by + bh);
-    if (x1 <= x0 || y1 <= y0) return 0;
-    *ox = x0;
-    *oy = y0;
-    *ow = x1 - x0;
-    *oh = y1 - y0;
-    return 1;
-}
-
-static void deimos_draw_window_clip(struct deimos_window_surface *s,
-                                    int x, int y, int w, int h, int focused,
+// Opaque windows assemble each clipped row from the native texels of the
+// window's client buffer and copy it straight into the backbuffer; translucent
+// ones build premultiplied XRGB spans for the SIMD blend kernel. Opaque rows
+// that would come out the same as the one above (same texel row, border or
+// strip) are copied down instead of being built again, so an upscaled
+// surface costs one row build per texel row.
+static void deimos_draw_window_clip(struct deimos_window_surface *s, const struct deimos_client_buffer *b,
+                                    int x, int y, int w, int h, int focused, uint32_t alpha,
                                     int clip_x, int clip_y, int clip_w, int clip_h) {
     uint32_t border_col = focused ? g_cfg.window_focus_color : g_cfg.window_border_color;
     uint32_t strip_col = focused ? colour_rgb(245, 245, 250) : colour_rgb(28, 32, 40);
 
-    int inner_x = x + 1;
-    int inner_y = y + 1;
-    int inner_w = w - 2;
-    int inner_h = h - 2;
-    int strip_h = (inner_h > 14) ? 12 : (inner_h / 2);
+    int bw = deimos_layout_border();
+    int inner_x = x + bw;
+    int inner_y = y + bw;
+    int inner_w = w - 2 * bw;
+    int inner_h = h - 2 * bw;
+    int strip_h = decor_strip_height(inner_h);
+    if (!focused && !deimos_gov_allows(DEIMOS_GOV_DECORATIONS)) strip_h = 0;
+    int detail = b && (focused || deimos_gov_allows(DEIMOS_GOV_SURFACE_DETAIL));
 
-    int y_end = clip_y + clip_h;
+    // Every pixel left after clamping is either border or interior.
     int x_end = clip_x + clip_w;
+    int y_end = clip_y + clip_h;
+    if (clip_x < x) clip_x = x;
+    if (clip_y < y) clip_y = y;
+    if (x_end > x + w) x_end = x + w;
+    if (y_end > y + h) y_end = y + h;
+
+    int native = (alpha == 255);
+    int bytes = render_format_bytes(render_format());
+    uint32_t border_native = render_native_colour(border_col);
+    uint32_t strip_native = render_native_colour(strip_col);
+    uint32_t average_native = render_native_colour(s->average);
+
+    uint32_t span[DEIMOS_SPAN_CHUNK];
+    uint8_t row[DEIMOS_SPAN_CHUNK * 4];
+    int prev_key = -1;
     for (int yy = clip_y; yy < y_end; yy++) {
-        for (int xx = clip_x; xx < x_end; xx++) {
-            int on_border = (xx == x) || (xx == (x + w - 1)) || (yy == y) || (yy == (y + h - 1));
-            if (on_border) {
-                render_putpixel(xx, yy, border_col);
-                continue;
-            }
+        int row_border = (yy < y + bw) || (yy >= (y + h - bw));
+        int in_strip = strip_h > 0 && yy < (inner_y + strip_h);
+        int sy = 0;
+        if (detail && inner_h > 0) {
+            sy = ((yy - inner_y) * b->height) / inner_h;
+            if (sy < 0) sy = 0;
+            if (sy >= b->height) sy = b->height - 1;
+        }
 
-            if (xx < inner_x || yy < inner_y || xx >= (inner_x + inner_w) || yy >= (inner_y + inner_h)) {
+        if (native) {
+            int key = row_border ? -2 : (in_strip ? -3 : sy);
+            if (key == prev_key) {
+                render_replicate_row(clip_x, yy - 1, x_end - clip_x, 1);
                 continue;
             }
+            prev_key = key;
+        }
 
-            int sx = ((xx - inner_x) * DEIMOS_SURFACE_W) / inner_w;
-            int sy = ((yy - inner_y) * DEIMOS_SURFACE_H) / inner_h;
-            if (sx < 0) sx = 0;
-            if (sy < 0) sy = 0;
-            if (sx >= DEIMOS_SURFACE_W) sx = DEIMOS_SURFACE_W - 1;
-            if (sy >= DEIMOS_SURFACE_H) sy = DEIMOS_SURFACE_H - 1;
+        for (int span_x = clip_x; span_x < x_end; span_x += DEIMOS_SPAN_CHUNK) {
+            int n = x_end - span_x;
+            if (n > DEIMOS_SPAN_CHUNK) n = DEIMOS_SPAN_CHUNK;
+
+            for (int i = 0; i < n; i++) {
+                int xx = span_x + i;
+                int on_border = row_border || (xx < x + bw) || (xx >= (x + w - bw));
+                if (native) {
+                    uint32_t v = average_native;
+                    if (on_border) {
+                        v = border_native;
+                    } else if (in_strip) {
+                        v = strip_native;
+                    } else if (detail) {
+                        int sx = ((xx - inner_x) * b->width) / inner_w;
+                        if (sx >= b->width) sx = b->width - 1;
+                        v = buffer_texel_native(b, sx, sy);
+                    }
+                    store_native(&row[i * bytes], bytes, v);
+                    continue;
+                }
 
-            uint32_t c = s->pixels[sy * DEIMOS_SURFACE_W + sx];
-            if (strip_h > 0 && yy < (inner_y + strip_h)) {
-                c = strip_col;
+                uint32_t c = s->average;
+                if (on_border) {
+                    c = border_col;
+                } else if (in_strip) {
+                    c = strip_col;
+                } else if (detail) {
+                    int sx = ((xx - inner_x) * b->width) / inner_w;
+                    if (sx >= b->width) sx = b->width - 1;
+                    c = buffer_texel_xrgb(b, sx, sy);
+                }
+                span[i] = alpha_premultiply(c, alpha);
+            }
+            if (native) {
+                render_copy_span_native(span_x, yy, row, n);
+            } else {
+                render_blend_span(span_x, yy, span, n);
             }
-            render_putpixel(xx, yy, c);
         }
     }
 }
@@ -189,96 +333,236 @@ void deimos_draw_window_frame(int window_id, int x, int y, int w, int h, int foc
         return;
     }
 
-    int dirty_count = render_dirty_count();
-    for (int i = 0; i < dirty_count; i++) {
-        int rx = render_dirty_x(i);
-        int ry = render_dirty_y(i);
-        int rw = render_dirty_w(i);
-        int rh = render_dirty_h(i);
-
-        int ix, iy, iw, ih;
-        if (!clip_intersection(x, y, w, h, rx, ry, rw, rh, &ix, &iy, &iw, &ih)) {
-            continue;
-        }
-        deimos_draw_window_clip(s, x, y, w, h, focused, ix, iy, iw, ih);
+    struct render_rect clips[RENDER_MAX_DIRTY_RECTS];
+    int clip_count = render_damage_clip(x, y, w, h, clips, RENDER_MAX_DIRTY_RECTS);
+    for (int i = 0; i < clip_count; i++) {
+        deimos_draw_window_clip(s, deimos_client_window_buffer(window_id), x, y, w, h, focused, 255, clips[i].x, clips[i].y, clips[i].w, clips[i].h);
     }
 }
 
-int deimos_theme_window_color(void) {
-    return (int)g_cfg.window_border_color;
-}
+// Blending is not idempotent, so translucent passes need damage pieces that
+// do not overlap one another (the dirty list may hold overlapping rects).
+#define DEIMOS_MAX_DISJOINT_CLIPS (RENDER_MAX_DIRTY_RECTS * 2)
 
-int deimos_theme_window_focus_color(void) {
-    return (int)g_cfg.window_focus_color;
+static int damage_clip_disjoint(int x, int y, int w, int h, struct render_rect *out, int max_out) {
+    struct render_rect clips[RENDER_MAX_DIRTY_RECTS];
+    int count = render_damage_clip(x, y, w, h, clips, RENDER_MAX_DIRTY_RECTS);
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        struct deimos_region piece;
+        deimos_region_set_rect(&piece, clips[i].x, clips[i].y, clips[i].w, clips[i].h);
+        for (int j = 0; j < i; j++) {
+            deimos_region_subtract_rect(&piece, &clips[j]);
+        }
+        for (int k = 0; k < piece.count && n < max_out; k++) {
+            out[n++] = piece.rects[k];
+        }
+    }
+    return n;
 }
 
-int deimos_theme_gap(void) {
-    return g_cfg.window_gap;
-}
+static void draw_window_visible_rect(const struct deimos_window_rect *r, int focused, uint32_t alpha,
+                                     const struct render_rect *visible) {
+    if (!render_rect_needs_redraw(visible->x, visible->y, visible->w, visible->h)) return;
 
-int deimos_split_vertical_bias_percent(void) {
-    return g_cfg.split_vertical_bias_percent;
-}
+    int whole = visible->x == r->x && visible->y == r->y && visible->w == r->w && visible->h == r->h;
+    if (whole && alpha == 255) {
+        deimos_draw_window_frame(r->id, r->x, r->y, r->w, r->h, focused);
+        return;
+    }
 
-int deimos_split_force_mode(void) {
-    return g_cfg.split_force_mode;
-}
+    init_window_surface(r->id);
+    struct deimos_window_surface *s = &g_surfaces[r->id];
+    if (!s->initialized) return;
 
-int deimos_should_draw_windows(void) {
-    return g_should_draw_windows;
+    struct render_rect clips[DEIMOS_MAX_DISJOINT_CLIPS];
+    int clip_count = (alpha == 255)
+        ? render_damage_clip(visible->x, visible->y, visible->w, visible->h, clips, RENDER_MAX_DIRTY_RECTS)
+        : damage_clip_disjoint(visible->x, visible->y, visible->w, visible->h, clips, DEIMOS_MAX_DISJOINT_CLIPS);
+    for (int i = 0; i < clip_count; i++) {
+        deimos_draw_window_clip(s, deimos_client_window_buffer(r->id), r->x, r->y, r->w, r->h, focused, alpha, clips[i].x, clips[i].y, clips[i].w, clips[i].h);
+    }
 }
 
-int deimos_should_draw_layout_window(int window_id) {
-    if (g_drag_active && g_drag_window_id > 0 && window_id == g_drag_window_id) {
-        return 0;
+// Shadow of a floating window: its margin ring (plus its own rect when the
+// window is translucent) minus everything stacked above it, within damage.
+static void draw_window_shadow(int slot, const struct deimos_window_rect *r, int translucent) {
+    int radius = g_cfg.shadow_radius;
+    if (radius <= 0 || g_cfg.shadow_opacity_percent <= 0) return;
+
+    struct deimos_region area;
+    deimos_region_set_rect(&area, r->x - radius, r->y - radius, r->w + 2 * radius, r->h + 2 * radius);
+    if (!translucent) {
+        struct render_rect own;
+        own.x = r->x;
+        own.y = r->y;
+        own.w = r->w;
+        own.h = r->h;
+        deimos_region_subtract_rect(&area, &own);
+    }
+    int count = deimos_stacking_count();
+    for (int above = slot + 1; above < count; above++) {
+        const struct deimos_window_rect *a = deimos_stacking_rect(above);
+        if (!a || (a->floating && translucent)) continue;
+        struct render_rect cut;
+        cut.x = a->x;
+        cut.y = a->y;
+        cut.w = a->w;
+        cut.h = a->h;
+        deimos_region_subtract_rect(&area, &cut);
     }
-    return 1;
-}
 
-void deimos_begin_window_report(void) {
-    g_curr_window_rect_count = 0;
-    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
-        g_curr_window_rects[i].valid = 0;
+    int opacity = (g_cfg.shadow_opacity_percent * 255) / 100;
+    struct render_rect clips[DEIMOS_MAX_DISJOINT_CLIPS];
+    for (int i = 0; i < area.count; i++) {
+        const struct render_rect *part = &area.rects[i];
+        int clip_count = damage_clip_disjoint(part->x, part->y, part->w, part->h, clips, DEIMOS_MAX_DISJOINT_CLIPS);
+        for (int c = 0; c < clip_count; c++) {
+            render_draw_shadow(r->x, r->y, r->w, r->h, radius, opacity,
+                               clips[c].x, clips[c].y, clips[c].w, clips[c].h);
+        }
     }
 }
 
-void deimos_report_window_rect(int index, int id, int x, int y, int w, int h) {
-    if (index < 0 || index >= DEIMOS_MAX_REPORT_WINDOWS) {
-        return;
+// Draw stage: walks the stacking order bottom to top and paints each window
+// only inside its visible region, so overlapping windows are not overdrawn.
+// The dragged window is hidden from the stacking while its preview is shown.
+// Windows whose grid cells do not touch the damage are skipped outright.
+static void draw_layout_windows(void) {
+    int focused_id = deimos_focus_window_id();
+    uint32_t damaged_ids = deimos_spatial_damage_mask();
+    if (!damaged_ids) return;
+
+    int count = deimos_stacking_count();
+    for (int slot = 0; slot < count; slot++) {
+        const struct deimos_window_rect *r = deimos_stacking_rect(slot);
+        const struct deimos_region *visible = deimos_stacking_visible(slot);
+        if (!r || !visible) continue;
+        if (r->id <= 0 || r->id > DEIMOS_MAX_REPORT_WINDOWS) continue;
+        if (!(damaged_ids & (1U << r->id))) continue;
+
+        DEIMOS_TRACE3(WINDOW_BEGIN, r->id, visible->count, r->floating);
+        uint32_t alpha = 255;
+        if (r->floating) {
+            alpha = (uint32_t)((g_cfg.float_opacity_percent * 255) / 100);
+            draw_window_shadow(slot, r, alpha < 255);
+        }
+        for (int i = 0; i < visible->count; i++) {
+            draw_window_visible_rect(r, r->id == focused_id, alpha, &visible->rects[i]);
+        }
+        DEIMOS_TRACE1(WINDOW_END, r->id);
     }
+}
 
-    g_curr_window_rects[index].id = id;
-    g_curr_window_rects[index].x = x;
-    g_curr_window_rects[index].y = y;
-    g_curr_window_rects[index].w = w;
-    g_curr_window_rects[index].h = h;
-    g_curr_window_rects[index].valid = 1;
+// What is drawn above the windows in one frame.
+struct deimos_overlays {
+    int drag_preview; // dragged window shown at `drag`
+    struct render_rect drag;
+    struct render_rect cursor;
+    struct render_rect fps_box;
+    int text_x;
+    int text_y;
+    const char *fps_text;
+};
 
-    if (index + 1 > g_curr_window_rect_count) {
-        g_curr_window_rect_count = index + 1;
+// Composes the damaged part of the bound output.
+static void draw_output(const struct deimos_overlays *o) {
+    render_begin_frame(g_cfg.background_color);
+    draw_layout_windows();
+
+    if (o->drag_preview) {
+        if (g_cfg.drag_preview_mode == 1 || !deimos_gov_allows(DEIMOS_GOV_DRAG_PREVIEW)) {
+            render_draw_rect(o->drag.x, o->drag.y, o->drag.w, o->drag.h, g_cfg.window_focus_color);
+        } else {
+            deimos_draw_window_frame(g_drag_window_id, o->drag.x, o->drag.y, o->drag.w, o->drag.h, 1);
+        }
     }
+
+    render_fill_rect_damaged(o->cursor.x, o->cursor.y, o->cursor.w, o->cursor.h, g_cfg.cursor_color);
+    render_fill_rect_damaged(o->fps_box.x, o->fps_box.y, o->fps_box.w, o->fps_box.h, g_cfg.fps_bg_color);
+    render_draw_text(o->text_x, o->text_y, o->fps_text, g_cfg.fps_fg_color);
 }
 
-static int u32_to_ascii(uint32_t value, char *out) {
-    char tmp[10];
-    int n = 0;
+// Draws the frame again as a full repaint and compares it with the
+// incremental one. On a mismatch the repaint replaces the frame, so the
+// verifier also keeps the screen correct while it reports.
+static void verify_output(int output, uint32_t frame, const struct deimos_overlays *o) {
+    if (!render_verify_begin()) return;
+    draw_output(o);
+    struct render_verify_result result;
+    deimos_verify_frame_checked();
+    uint32_t mismatches = render_verify_end(&result);
+    DEIMOS_TRACE2(VERIFY, output, mismatches);
+    if (mismatches == 0) return;
+
+    deimos_verify_report(frame, output, &result);
+    render_verify_adopt();
+}
 
-    if (value == 0) {
-        out[0] = '0';
-        out[1] = '\0';
-        return 1;
+// Leaves the active workspace with a snapshot of its presented frame and
+// shows the target's snapshot straight away; the caller then re-runs layout,
+// which only damages what changed since that snapshot was taken.
+static void switch_workspace(int target, const struct render_rect *overlays, int overlay_count) {
+    int from = deimos_wm_workspace();
+    if (target == from) return;
+
+    deimos_snapshot_capture(from, target, overlays, overlay_count);
+    if (!deimos_wm_switch_workspace(target)) return;
+    DEIMOS_TRACE2(WORKSPACE, from, target);
+    // Attach content first, so its damage is superseded by the restore.
+    for (int id = 1; id <= deimos_wm_window_count() && id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+        init_window_surface(id);
     }
 
-    while (value > 0 && n < 10) {
-        tmp[n++] = (char)('0' + (value % 10));
-        value /= 10;
+    if (!deimos_snapshot_restore(target)) {
+        // Nothing of the target is on screen: start from an empty table so its
+        // windows appear in place instead of animating from the old workspace.
+        deimos_layout_adopt(0, 0);
+        render_mark_full_dirty();
     }
-
-    for (int i = 0; i < n; i++) {
-        out[i] = tmp[n - 1 - i];
+    // Snapshots hold the framebuffer output only; the others repaint.
+    for (int output = 1; output < render_output_count(); output++) {
+        render_output_mark_full_dirty(output);
     }
-    out[n] = '\0';
-    return n;
+}
+
+// Only worth a line when the input queue filled up.
+static void print_input_summary(void) {
+    struct deimos_input_stats stats;
+    deimos_input_get_stats(&stats);
+    if (stats.full == 0) return;
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] input: ");
+    n = deimos_append_u32(line, n, stats.full);
+    n = deimos_append_str(line, n, " collections stopped at a full queue\n");
+    line[n] = '\0';
+    print(line);
+}
+
+// Writes per presented pixel (x100) and wasted present KiB per frame of the
+// framebuffer output over the last second.
+static void overdraw_hud_update(struct render_overdraw_stats *prev, uint32_t *x100, uint32_t *wasted_k) {
+    struct render_overdraw_stats now;
+    render_overdraw_get_stats(&now);
+    uint64_t presented = now.presented_pixels - prev->presented_pixels;
+    uint32_t frames = now.frames - prev->frames;
+    *x100 = presented ? (uint32_t)(((now.writes - prev->writes) * 100U) / presented) : 0;
+    *wasted_k = frames ? (uint32_t)((now.wasted_bytes - prev->wasted_bytes) / frames / 1024U) : 0;
+    *prev = now;
+}
+
+// Appends " OD: 1.84 WB: 12K" at n; returns the new length.
+static int format_overdraw_hud(char *out, int n, uint32_t x100, uint32_t wasted_k) {
+    n = deimos_append_str(out, n, " OD: ");
+    n = deimos_append_u32(out, n, x100 / 100U);
+    n = deimos_append_str(out, n, ".");
+    if (x100 % 100U < 10U) n = deimos_append_str(out, n, "0");
+    n = deimos_append_u32(out, n, x100 % 100U);
+    n = deimos_append_str(out, n, " WB: ");
+    n = deimos_append_u32(out, n, wasted_k);
+    return deimos_append_str(out, n, "K");
 }
 
 static int key_matches(char input_key, char bind_key) {
@@ -297,50 +581,24 @@ static int modifiers_match(uint8_t active_mods, int required_mask) {
     return ((active_mods & (uint8_t)required_mask) == (uint8_t)required_mask);
 }
 
-static struct deimos_window_rect *find_rect_by_id(struct deimos_window_rect *rects, int count, int id) {
-    for (int i = 0; i < count; i++) {
-        if (rects[i].valid && rects[i].id == id) {
-            return &rects[i];
-        }
-    }
-    return 0;
-}
-
-static int rect_equals(const struct deimos_window_rect *a, const struct deimos_window_rect *b) {
-    if (!a || !b) return 0;
-    return (a->x == b->x) && (a->y == b->y) && (a->w == b->w) && (a->h == b->h);
-}
-
-static int point_in_rect(const struct deimos_window_rect *r, int x, int y) {
-    if (!r || !r->valid) return 0;
-    if (r->w <= 0 || r->h <= 0) return 0;
-    if (x < r->x || y < r->y) return 0;
-    if (x >= (r->x + r->w) || y >= (r->y + r->h)) return 0;
-    return 1;
-}
-
-static void mark_rect_dirty(const struct deimos_window_rect *r) {
-    if (!r || !r->valid) return;
-    render_mark_dirty_rect(r->x, r->y, r->w, r->h);
-}
-
 static void mark_focus_visual_dirty(const struct deimos_window_rect *r) {
     if (!r || !r->valid) return;
     if (r->w <= 0 || r->h <= 0) return;
 
     // Border pixels.
-    render_mark_dirty_rect(r->x, r->y, r->w, 1);
-    render_mark_dirty_rect(r->x, r->y + r->h - 1, r->w, 1);
-    render_mark_dirty_rect(r->x, r->y, 1, r->h);
-    render_mark_dirty_rect(r->x + r->w - 1, r->y, 1, r->h);
+    int bw = deimos_layout_border();
+    render_mark_dirty_rect(r->x, r->y, r->w, bw);
+    render_mark_dirty_rect(r->x, r->y + r->h - bw, r->w, bw);
+    render_mark_dirty_rect(r->x, r->y, bw, r->h);
+    render_mark_dirty_rect(r->x + r->w - bw, r->y, bw, r->h);
 
     // Title strip inside the surface (focus tint change).
-    int inner_w = r->w - 2;
-    int inner_h = r->h - 2;
+    int inner_w = r->w - 2 * bw;
+    int inner_h = r->h - 2 * bw;
     if (inner_w > 0 && inner_h > 0) {
-        int strip_h = (inner_h > 14) ? 12 : (inner_h / 2);
+        int strip_h = decor_strip_height(inner_h);
         if (strip_h > 0) {
-            render_mark_dirty_rect(r->x + 1, r->y + 1, inner_w, strip_h);
+            render_mark_dirty_rect(r->x + bw, r->y + bw, inner_w, strip_h);
         }
     }
 }
@@ -348,61 +606,113 @@ static void mark_focus_visual_dirty(const struct deimos_window_rect *r) {
 static void mark_drag_preview_dirty(int x, int y, int w, int h) {
     if (w <= 0 || h <= 0) return;
     if (g_cfg.drag_preview_mode == 1) {
-        render_mark_dirty_rect(x, y, w, 1);
-        render_mark_dirty_rect(x, y + h - 1, w, 1);
-        render_mark_dirty_rect(x, y, 1, h);
-        render_mark_dirty_rect(x + w - 1, y, 1, h);
+        int bw = deimos_layout_border();
+        render_mark_dirty_rect(x, y, w, bw);
+        render_mark_dirty_rect(x, y + h - bw, w, bw);
+        render_mark_dirty_rect(x, y, bw, h);
+        render_mark_dirty_rect(x + w - bw, y, bw, h);
         return;
     }
     render_mark_dirty_rect(x, y, w, h);
 }
 
-static int find_hovered_window_id(int mouse_x, int mouse_y) {
-    for (int i = g_prev_window_rect_count - 1; i >= 0; i--) {
-        if (point_in_rect(&g_prev_window_rects[i], mouse_x, mouse_y)) {
-            return g_prev_window_rects[i].id;
-        }
+// Repaints what a governor step between levels `from` and `to` changes.
+// Animation and drag-preview levels only affect later frames; decorations
+// and surface detail are dropped on unfocused windows only.
+static void mark_quality_dirty(int from, int to) {
+    int high = from > to ? from : to;
+    if (high < DEIMOS_GOV_DECORATIONS) return;
+
+    int focused_id = deimos_focus_window_id();
+    int count = deimos_layout_count();
+    for (int i = 0; i < count; i++) {
+        const struct deimos_window_rect *r = deimos_layout_rect_at(i);
+        if (!r || r->id == focused_id) continue;
+        render_mark_dirty_rect(r->x, r->y, r->w, r->h);
     }
-    return -1;
 }
 
-static void mark_focus_change_dirty(int old_focus_id, int new_focus_id) {
-    if (old_focus_id == new_focus_id) return;
-
-    struct deimos_window_rect *old_rect = find_rect_by_id(g_prev_window_rects, g_prev_window_rect_count, old_focus_id);
-    struct deimos_window_rect *new_rect = find_rect_by_id(g_prev_window_rects, g_prev_window_rect_count, new_focus_id);
-    mark_focus_visual_dirty(old_rect);
-    mark_focus_visual_dirty(new_rect);
+// The layout scales the gap along with its margins.
+static int split_grab_band(void) {
+    int s = render_ui_scale();
+    int band = (g_cfg.window_gap + 2) * s;
+    return (band < 3 * s) ? 3 * s : band;
 }
 
-static void mark_window_layout_dirty_from_reports(void) {
-    for (int i = 0; i < g_prev_window_rect_count; i++) {
-        if (!g_prev_window_rects[i].valid) continue;
-        struct deimos_window_rect *curr = find_rect_by_id(g_curr_window_rects, g_curr_window_rect_count, g_prev_window_rects[i].id);
-        if (!curr) {
-            mark_rect_dirty(&g_prev_window_rects[i]);
-            continue;
-        }
-        if (!rect_equals(&g_prev_window_rects[i], curr)) {
-            mark_rect_dirty(&g_prev_window_rects[i]);
-            mark_rect_dirty(curr);
-        }
+static int update_split_ratio_from_mouse(int split_index, int mouse_x, int mouse_y) {
+    const struct deimos_split_info *sp = deimos_layout_split(split_index);
+    if (!sp) return 0;
+
+    int permille;
+    if (sp->orient == DEIMOS_SPLIT_ORIENT_VERTICAL) {
+        if (sp->w <= 0) return 0;
+        permille = ((mouse_x - sp->x) * 1000) / sp->w;
+    } else {
+        if (sp->h <= 0) return 0;
+        permille = ((mouse_y - sp->y) * 1000) / sp->h;
     }
+    return deimos_wm_set_split_ratio(split_index, permille);
+}
 
-    for (int i = 0; i < g_curr_window_rect_count; i++) {
-        if (!g_curr_window_rects[i].valid) continue;
-        struct deimos_window_rect *prev = find_rect_by_id(g_prev_window_rects, g_prev_window_rect_count, g_curr_window_rects[i].id);
-        if (!prev) {
-            mark_rect_dirty(&g_curr_window_rects[i]);
-        }
+static int toggle_focused_floating(void) {
+    int window_id = deimos_focus_window_id();
+    const struct deimos_window_rect *r = deimos_layout_find(window_id);
+    if (!r) return 0;
+
+    int w = (r->w * 2) / 3;
+    int h = (r->h * 2) / 3;
+    int x = r->x + ((r->w - w) / 2);
+    int y = r->y + ((r->h - h) / 2);
+    return deimos_wm_toggle_floating(window_id, x, y, w, h);
+}
+
+// Floats the focused window (if tiled) and centres it on the next output.
+static int move_focused_to_next_output(void) {
+    int count = render_output_count();
+    if (count < 2) return 0;
+
+    int window_id = deimos_focus_window_id();
+    const struct deimos_window_rect *r = deimos_layout_find(window_id);
+    if (!r || !r->valid) return 0;
+
+    int current = render_output_at(r->x + r->w / 2, r->y + r->h / 2);
+    struct render_rect target;
+    if (!render_output_geometry((current + 1) % count, &target)) return 0;
+
+    int floating = deimos_wm_is_floating(window_id);
+    int w = floating ? r->w : (r->w * 2) / 3;
+    int h = floating ? r->h : (r->h * 2) / 3;
+    if (w > target.w) w = target.w;
+    if (h > target.h) h = target.h;
+    int x = target.x + (target.w - w) / 2;
+    int y = target.y + (target.h - h) / 2;
+    if (!floating) {
+        return deimos_wm_toggle_floating(window_id, x, y, w, h);
     }
+    return deimos_wm_set_float_position(window_id, x, y);
 }
 
-static void copy_current_reports_to_previous(void) {
-    g_prev_window_rect_count = g_curr_window_rect_count;
-    for (int i = 0; i < DEIMOS_MAX_REPORT_WINDOWS; i++) {
-        g_prev_window_rects[i] = g_curr_window_rects[i];
+static int drop_dragged_window(int window_id, int mouse_x, int mouse_y, int preview_x, int preview_y) {
+    if (deimos_wm_is_floating(window_id)) {
+        return deimos_wm_set_float_position(window_id, preview_x, preview_y);
+    }
+    if (!deimos_wm_set_split_for_window_id(window_id, mouse_x, mouse_y)) {
+        return 0;
+    }
+
+    // The tile settles into its new slot from where the preview was dropped.
+    const struct deimos_window_rect *r = deimos_layout_find(window_id);
+    if (r) {
+        deimos_layout_set_origin(window_id, preview_x, preview_y, r->w, r->h);
     }
+    return 1;
+}
+
+static void mark_focus_change_dirty(int old_focus_id, int new_focus_id) {
+    if (old_focus_id == new_focus_id) return;
+
+    mark_focus_visual_dirty(deimos_layout_find(old_focus_id));
+    mark_focus_visual_dirty(deimos_layout_find(new_focus_id));
 }
 
 int main(int argc, char **argv) {
@@ -417,6 +727,9 @@ int main(int argc, char **argv) {
         print("[deimos] using defaults (missing /cfg/deimos.conf)\n");
     }
 
+    render_set_present_buffers(g_cfg.present_buffers);
+    render_set_ui_scale(g_cfg.ui_scale);
+    render_set_overdraw(g_cfg.overdraw_debug);
     int rc = render_init();
     if (rc != 0) {
         print("[deimos] render_init FAILED\n");
@@ -424,18 +737,43 @@ int main(int argc, char **argv) {
         return 1;
     }
     print("[deimos] render_init ok\n");
+    if (g_cfg.wallpaper_path[0]) {
+        wallpaper_load(g_cfg.wallpaper_path, g_cfg.wallpaper_mode, g_cfg.dither_rgb565);
+    }
+    for (int i = 0; i < g_cfg.virtual_output_count; i++) {
+        const struct deimos_virtual_output *vo = &g_cfg.virtual_outputs[i];
+        if (render_output_add_virtual(vo->width, vo->height, vo->bpp) < 0) {
+            print("[deimos] virtual output rejected\n");
+        }
+    }
+    if (g_cfg.capture_path[0]) {
+        capture_start(g_cfg.capture_path, g_cfg.capture_keyframe_interval);
+    }
+    if (g_cfg.remote_out_path[0]) {
+        deimos_remote_start(g_cfg.remote_out_path, g_cfg.remote_in_path);
+    }
+    if (g_cfg.trace_path[0]) {
+        deimos_trace_start(g_cfg.trace_path, g_cfg.trace_format);
+    }
 
     const uint32_t ticks_per_second = 100;
     uint64_t last_fps_tick = ticks();
     uint32_t frames_this_second = 0;
     uint32_t fps = 0;
     uint32_t presented_frames = 0;
+    struct render_overdraw_stats overdraw_prev;
+    render_overdraw_get_stats(&overdraw_prev);
+    uint32_t overdraw_x100 = 0;
+    uint32_t overdraw_wasted_k = 0;
 
     int mouse_x = render_width() / 2;
     int mouse_y = render_height() / 2;
     int prev_mouse_x = mouse_x;
     int prev_mouse_y = mouse_y;
     int cursor_valid = 0;
+    // The cursor is a square of ui_scale-sized 3x3 pixels around the pointer.
+    const int cursor_size = 3 * render_ui_scale();
+    const int cursor_off = cursor_size / 2;
 
     int fps_box_x = 0;
     int fps_box_y = 0;
@@ -451,8 +789,15 @@ int main(int argc, char **argv) {
     int drag_preview_w = 0;
     int drag_preview_h = 0;
     int drag_preview_valid = 0;
+    int resize_split_index = -1;
+    int pending_workspace = -1;
 
     deimos_wm_init(mouse_x, mouse_y);
+    int anim_us = g_cfg.anim_duration_ms * 1000;
+    deimos_anim_set_duration(anim_us);
+    deimos_gov_init(g_cfg.governor_target_fps);
+    deimos_layout_set_float_margin(g_cfg.shadow_radius);
+    deimos_stacking_set_floating_occludes(g_cfg.float_opacity_percent >= 100);
     render_mark_full_dirty();
 
     print("[deimos] using configured keybinds (see /cfg/deimos.conf)\n");
@@ -460,11 +805,31 @@ int main(int argc, char **argv) {
     while (1) {
         int should_quit = 0;
         int layout_changed = 0;
+        int layout_animate = deimos_gov_allows(DEIMOS_GOV_ANIMATION);
         int fps_changed = 0;
         int drag_preview_update_needed = 0;
-
+        int resize_update_needed = 0;
+
+        DEIMOS_TRACE1(FRAME_BEGIN, presented_frames);
+        DEIMOS_TRACE0(INPUT_DRAIN_BEGIN);
+        deimos_remote_pump();
+        // Events collected during the last frame are handled in one batch,
+        // followed by the remote viewer's.
+        deimos_input_collect();
+        struct deimos_input_item input_batch[DEIMOS_INPUT_BATCH];
+        int input_batch_count = deimos_input_drain(input_batch, DEIMOS_INPUT_BATCH);
+        int input_batch_next = 0;
         struct user_input_event ev;
-        while (input_poll(&ev) == 1) {
+        uint32_t input_events = 0;
+        while (input_batch_next < input_batch_count || deimos_remote_poll_event(&ev)) {
+            if (input_batch_next < input_batch_count) {
+                ev = input_batch[input_batch_next++].ev;
+            }
+            if (g_cfg.damage_verify) {
+                deimos_verify_note_event(presented_frames, &ev);
+            }
+            DEIMOS_TRACE5(INPUT, ev.type, ev.mouse_x, ev.mouse_y, ev.key, ev.pressed);
+            input_events++;
             if (ev.type == INPUT_EVENT_MOUSE_MOVE || ev.type == INPUT_EVENT_MOUSE_BUTTON) {
                 mouse_x = ev.mouse_x;
                 mouse_y = ev.mouse_y;
@@ -479,16 +844,29 @@ int main(int argc, char **argv) {
                         : DEIMOS_SPLIT_TARGET_MOUSE;
                     deimos_wm_add_window_split(mouse_x, mouse_y, mode);
                     layout_changed = 1;
+                } else if (key_matches((char)ev.key, g_cfg.key_toggle_float)) {
+                    if (toggle_focused_floating()) {
+                        layout_changed = 1;
+                    }
+                } else if (key_matches((char)ev.key, g_cfg.key_next_output)) {
+                    if (move_focused_to_next_output()) {
+                        layout_changed = 1;
+                    }
+                } else if (key_matches((char)ev.key, g_cfg.key_next_workspace)) {
+                    pending_workspace = (deimos_wm_workspace() + 1) % DEIMOS_MAX_WORKSPACES;
+                } else if (ev.key >= '1' && ev.key < '1' + DEIMOS_MAX_WORKSPACES) {
+                    pending_workspace = ev.key - '1';
                 }
             }
 
             if (ev.type == INPUT_EVENT_MOUSE_BUTTON && ev.scancode == 1) {
                 if (ev.pressed == 0) {
+                    resize_split_index = -1;
                     if (g_drag_active && g_drag_window_id > 0) {
                         if (drag_preview_valid) {
                             mark_drag_preview_dirty(drag_preview_x, drag_preview_y, drag_preview_w, drag_preview_h);
                         }
-                        if (deimos_wm_set_split_for_window_id(g_drag_window_id, mouse_x, mouse_y)) {
+                        if (drop_dragged_window(g_drag_window_id, mouse_x, mouse_y, drag_preview_x, drag_preview_y)) {
                             layout_changed = 1;
                         }
                     }
@@ -496,9 +874,17 @@ int main(int argc, char **argv) {
                     g_drag_window_id = -1;
                     drag_preview_valid = 0;
                 } else {
-                    int hovered_window_id = find_hovered_window_id(mouse_x, mouse_y);
+                    int hovered_window_id = deimos_stacking_hit_test(mouse_x, mouse_y);
+                    int grabbed_split = -1;
+                    if (hovered_window_id <= 0) {
+                        grabbed_split = deimos_layout_split_at(mouse_x, mouse_y, split_grab_band());
+                    }
 
-                    if (hovered_window_id > 0) {
+                    if (grabbed_split > 0) {
+                        // Freeze the tree so moving this boundary only rescales.
+                        deimos_layout_pin_splits();
+                        resize_split_index = grabbed_split;
+                    } else if (hovered_window_id > 0) {
                         int old_focus_id = deimos_focus_window_id();
                         if (deimos_wm_set_focus_window_id(hovered_window_id)) {
                             int new_focus_id = deimos_focus_window_id();
@@ -510,8 +896,7 @@ int main(int argc, char **argv) {
                     }
 
                     if (hovered_window_id > 0 && modifiers_match(ev.modifiers, g_cfg.drag_modifier_mask)) {
-                        struct deimos_window_rect *hovered_rect =
-                            find_rect_by_id(g_prev_window_rects, g_prev_window_rect_count, hovered_window_id);
+                        const struct deimos_window_rect *hovered_rect = deimos_layout_find(hovered_window_id);
                         if (hovered_rect && hovered_rect->valid) {
                             int ox = mouse_x - hovered_rect->x;
                             int oy = mouse_y - hovered_rect->y;
@@ -547,13 +932,22 @@ int main(int argc, char **argv) {
                 }
             }
 
+            if ((ev.type == INPUT_EVENT_MOUSE_MOVE || ev.type == INPUT_EVENT_MOUSE_BUTTON) &&
+                resize_split_index > 0) {
+                if ((ev.mouse_buttons & 1U) == 0) {
+                    resize_split_index = -1;
+                } else {
+                    resize_update_needed = 1;
+                }
+            }
+
             if ((ev.type == INPUT_EVENT_MOUSE_MOVE || ev.type == INPUT_EVENT_MOUSE_BUTTON) &&
                 g_drag_active && g_drag_window_id > 0) {
                 if ((ev.mouse_buttons & 1U) == 0) {
                     if (drag_preview_valid) {
                         mark_drag_preview_dirty(drag_preview_x, drag_preview_y, drag_preview_w, drag_preview_h);
                     }
-                    if (deimos_wm_set_split_for_window_id(g_drag_window_id, mouse_x, mouse_y)) {
+                    if (drop_dragged_window(g_drag_window_id, mouse_x, mouse_y, drag_preview_x, drag_preview_y)) {
                         layout_changed = 1;
                     }
                     g_drag_active = 0;
@@ -564,15 +958,69 @@ int main(int argc, char **argv) {
                 }
             }
         }
+        DEIMOS_TRACE1(INPUT_DRAIN_END, input_events);
+
+        // Copy-out of the last frame overlaps with input handling and layout.
+        render_present_pump(DEIMOS_PRESENT_SLICE_PIXELS);
+        deimos_input_collect();
 
         if (should_quit) {
+            DEIMOS_TRACE1(FRAME_END, 0);
             break;
         }
 
+        if (pending_workspace >= 0) {
+            if (pending_workspace != deimos_wm_workspace()) {
+                struct render_rect overlays[2];
+                int overlay_count = 0;
+                if (cursor_valid) {
+                    overlays[overlay_count].x = prev_mouse_x - cursor_off;
+                    overlays[overlay_count].y = prev_mouse_y - cursor_off;
+                    overlays[overlay_count].w = cursor_size;
+                    overlays[overlay_count].h = cursor_size;
+                    overlay_count++;
+                }
+                if (fps_box_valid) {
+                    overlays[overlay_count].x = fps_box_x;
+                    overlays[overlay_count].y = fps_box_y;
+                    overlays[overlay_count].w = fps_box_w;
+                    overlays[overlay_count].h = fps_box_h;
+                    overlay_count++;
+                }
+
+                g_drag_active = 0;
+                g_drag_window_id = -1;
+                drag_preview_valid = 0;
+                resize_split_index = -1;
+                deimos_stacking_set_hidden(-1);
+
+                switch_workspace(pending_workspace, overlays, overlay_count);
+                // The restored frame holds its own cursor/FPS box; redraw ours.
+                cursor_valid = 0;
+                fps_box_valid = 0;
+                layout_changed = 1;
+            }
+            pending_workspace = -1;
+        }
+
         int window_count = deimos_wm_window_count();
         if (window_count != prev_window_count) {
             prev_window_count = window_count;
             layout_changed = 1;
+            // Commit new windows' content before drawing, so its damage is
+            // part of this frame rather than added while it is painted.
+            for (int id = 1; id <= window_count && id <= DEIMOS_MAX_REPORT_WINDOWS; id++) {
+                init_window_surface(id);
+            }
+        }
+
+        if (resize_split_index > 0 && resize_update_needed) {
+            // Only the layout re-runs; its diff damages the windows whose
+            // rects changed, which covers the strip the boundary swept.
+            if (update_split_ratio_from_mouse(resize_split_index, mouse_x, mouse_y)) {
+                layout_changed = 1;
+                layout_animate = 0; // boundary tracks the pointer directly
+            }
         }
 
         if (g_drag_active && drag_preview_valid && drag_preview_update_needed) {
@@ -580,11 +1028,11 @@ int main(int argc, char **argv) {
             int next_y = mouse_y - drag_offset_y;
             if (next_x < 0) next_x = 0;
             if (next_y < 0) next_y = 0;
-            if (next_x + drag_preview_w > render_width()) {
-                next_x = render_width() - drag_preview_w;
+            if (next_x + drag_preview_w > render_desktop_width()) {
+                next_x = render_desktop_width() - drag_preview_w;
             }
-            if (next_y + drag_preview_h > render_height()) {
-                next_y = render_height() - drag_preview_h;
+            if (next_y + drag_preview_h > render_desktop_height()) {
+                next_y = render_desktop_height() - drag_preview_h;
             }
             if (next_x < 0) next_x = 0;
             if (next_y < 0) next_y = 0;
@@ -598,43 +1046,47 @@ int main(int argc, char **argv) {
         }
 
         if (!cursor_valid) {
-            render_mark_dirty_rect(mouse_x - 1, mouse_y - 1, 3, 3);
+            render_mark_dirty_rect(mouse_x - cursor_off, mouse_y - cursor_off, cursor_size, cursor_size);
             prev_mouse_x = mouse_x;
             prev_mouse_y = mouse_y;
             cursor_valid = 1;
         } else if (mouse_x != prev_mouse_x || mouse_y != prev_mouse_y) {
-            render_mark_dirty_rect(prev_mouse_x - 1, prev_mouse_y - 1, 3, 3);
-            render_mark_dirty_rect(mouse_x - 1, mouse_y - 1, 3, 3);
+            render_mark_dirty_rect(prev_mouse_x - cursor_off, prev_mouse_y - cursor_off, cursor_size, cursor_size);
+            render_mark_dirty_rect(mouse_x - cursor_off, mouse_y - cursor_off, cursor_size, cursor_size);
             prev_mouse_x = mouse_x;
             prev_mouse_y = mouse_y;
         }
 
         frames_this_second++;
         uint64_t now = ticks();
+        uint64_t frame_us = deimos_gov_clock_us();
         if (now - last_fps_tick >= ticks_per_second) {
             fps = frames_this_second;
+            if (g_cfg.overdraw_debug) {
+                overdraw_hud_update(&overdraw_prev, &overdraw_x100, &overdraw_wasted_k);
+            }
             frames_this_second = 0;
             last_fps_tick = now;
             fps_changed = 1;
         }
 
-        char fps_text[20];
-        fps_text[0] = 'F';
-        fps_text[1] = 'P';
-        fps_text[2] = 'S';
-        fps_text[3] = ':';
-        fps_text[4] = ' ';
-        int len = 5 + u32_to_ascii(fps, &fps_text[5]);
+        char fps_text[DEIMOS_LINE];
+        int len = deimos_append_str(fps_text, 0, "FPS: ");
+        len = deimos_append_u32(fps_text, len, fps);
+        if (g_cfg.overdraw_debug) {
+            len = format_overdraw_hud(fps_text, len, overdraw_x100, overdraw_wasted_k);
+        }
         fps_text[len] = '\0';
 
+        int ui = render_ui_scale();
         int text_w = render_text_width(fps_text);
-        int text_x = render_width() - text_w - 8;
+        int text_x = render_width() - text_w - 8 * ui;
         if (text_x < 0) text_x = 0;
-        int text_y = 8;
-        int next_fps_box_x = text_x - 3;
-        int next_fps_box_y = text_y - 2;
-        int next_fps_box_w = text_w + 6;
-        int next_fps_box_h = 11;
+        int text_y = 8 * ui;
+        int next_fps_box_x = text_x - 3 * ui;
+        int next_fps_box_y = text_y - 2 * ui;
+        int next_fps_box_w = text_w + 6 * ui;
+        int next_fps_box_h = render_text_height() + 4 * ui;
 
         if (!fps_box_valid) {
             render_mark_dirty_rect(next_fps_box_x, next_fps_box_y, next_fps_box_w, next_fps_box_h);
@@ -653,16 +1105,15 @@ int main(int argc, char **argv) {
         fps_box_h = next_fps_box_h;
 
         if (layout_changed) {
-            g_should_draw_windows = 0;
-            deimos_begin_window_report();
-            mt_heap_reset();
-            deimos_compositor_test_frame_with_count(window_count);
-            mark_window_layout_dirty_from_reports();
-            copy_current_reports_to_previous();
+            DEIMOS_TRACE1(LAYOUT_BEGIN, window_count);
+            deimos_shared_state_sync(&g_cfg);
+            deimos_layout_run(window_count, frame_us, layout_animate);
+            DEIMOS_TRACE0(LAYOUT_END);
         }
+        deimos_layout_animate(frame_us);
 
-        if (g_cfg.mouse_focus_follows_hover && !g_drag_active) {
-            int hovered_window_id = find_hovered_window_id(mouse_x, mouse_y);
+        if (g_cfg.mouse_focus_follows_hover && !g_drag_active && resize_split_index <= 0) {
+            int hovered_window_id = deimos_stacking_hit_test(mouse_x, mouse_y);
             if (hovered_window_id > 0) {
                 int old_focus_id = deimos_focus_window_id();
                 if (deimos_wm_set_focus_window_id(hovered_window_id)) {
@@ -672,46 +1123,95 @@ int main(int argc, char **argv) {
             }
         }
 
-        if ((presented_frames % 180U) == 0U) {
+        // Picks up layout/raise/drag changes and damages newly exposed areas.
+        deimos_stacking_set_hidden(g_drag_active ? g_drag_window_id : -1);
+        deimos_stacking_update();
+
+        if (g_cfg.full_repaint_interval > 0 &&
+            (presented_frames % (uint32_t)g_cfg.full_repaint_interval) == 0U) {
             render_mark_full_dirty();
         }
 
-        if (render_has_dirty()) {
-            g_should_draw_windows = 1;
-            deimos_begin_window_report();
-            mt_heap_reset();
-            render_begin_frame(g_cfg.background_color);
-            deimos_compositor_test_frame_with_count(window_count);
-
-            if (g_drag_active && g_drag_window_id > 0 && drag_preview_valid) {
-                if (g_cfg.drag_preview_mode == 1) {
-                    render_draw_rect(drag_preview_x, drag_preview_y, drag_preview_w, drag_preview_h, g_cfg.window_focus_color);
-                } else {
-                    deimos_draw_window_surface_full(
-                        g_drag_window_id,
-                        drag_preview_x,
-                        drag_preview_y,
-                        drag_preview_w,
-                        drag_preview_h,
-                        1
-                    );
-                    render_draw_rect(drag_preview_x, drag_preview_y, drag_preview_w, drag_preview_h, g_cfg.window_focus_color);
-                }
+        struct deimos_overlays overlays;
+        overlays.drag_preview = g_drag_active && g_drag_window_id > 0 && drag_preview_valid;
+        overlays.drag.x = drag_preview_x;
+        overlays.drag.y = drag_preview_y;
+        overlays.drag.w = drag_preview_w;
+        overlays.drag.h = drag_preview_h;
+        overlays.cursor.x = mouse_x - cursor_off;
+        overlays.cursor.y = mouse_y - cursor_off;
+        overlays.cursor.w = cursor_size;
+        overlays.cursor.h = cursor_size;
+        overlays.fps_box.x = next_fps_box_x;
+        overlays.fps_box.y = next_fps_box_y;
+        overlays.fps_box.w = next_fps_box_w;
+        overlays.fps_box.h = next_fps_box_h;
+        overlays.text_x = text_x;
+        overlays.text_y = text_y;
+        overlays.fps_text = fps_text;
+
+        // Each output with damage composes and presents on its own; capture
+        // and remote export follow the framebuffer output.
+        int quality_changed = 0;
+        int gov_level = deimos_gov_level();
+        int drew = 0;
+        uint64_t frame_begin = 0;
+        for (int output = 0; output < render_output_count(); output++) {
+            render_output_bind(output);
+            if (!render_has_dirty()) continue;
+            if (!drew) {
+                frame_begin = deimos_gov_begin_frame();
+                drew = 1;
             }
 
-            render_fill_rect(mouse_x - 1, mouse_y - 1, 3, 3, g_cfg.cursor_color);
-            render_fill_rect(text_x - 3, text_y - 2, text_w + 6, 11, g_cfg.fps_bg_color);
-            render_draw_text(text_x, text_y, fps_text, g_cfg.fps_fg_color);
+            DEIMOS_TRACE3(COMPOSE_BEGIN, output, render_is_full_dirty(), render_dirty_count());
+            draw_output(&overlays);
+            DEIMOS_TRACE1(COMPOSE_END, output);
+            if (g_cfg.damage_verify) {
+                verify_output(output, presented_frames, &overlays);
+            }
 
             render_present_dirty();
+            if (output == 0) {
+                capture_frame();
+                deimos_remote_frame();
+            }
             render_reset_dirty();
-            copy_current_reports_to_previous();
+            deimos_input_collect();
+        }
+        render_output_bind(0);
+
+        if (drew) {
             presented_frames++;
+            quality_changed = deimos_gov_end_frame(frame_begin);
+        } else {
+            quality_changed = deimos_gov_idle_frame();
+        }
+
+        if (quality_changed) {
+            DEIMOS_TRACE2(GOVERNOR, gov_level, deimos_gov_level());
+            // Settle running transitions at once when animations are dropped,
+            // and repaint the windows the new quality level draws differently.
+            deimos_anim_set_duration(deimos_gov_allows(DEIMOS_GOV_ANIMATION) ? anim_us : 0);
+            mark_quality_dirty(gov_level, deimos_gov_level());
         }
 
+        render_present_pump(DEIMOS_PRESENT_SLICE_PIXELS);
+        deimos_input_collect();
+        DEIMOS_TRACE1(FRAME_END, drew);
+        deimos_trace_flush();
+        DEIMOS_TRACE0(YIELD_BEGIN);
         yield();
+        DEIMOS_TRACE0(YIELD_END);
     }
 
+    render_present_drain();
+    capture_stop();
+    deimos_remote_stop();
+    deimos_verify_summary();
+    deimos_gov_summary();
+    print_input_summary();
+    deimos_trace_stop();
     exit(0);
     return 0;
 }
@@ -0,0 +1,210 @@
+#include "alpha.h"
+#include <emmintrin.h>
+#include <immintrin.h>
+
+typedef void (*alpha_span_fn)(uint32_t *dst, const uint32_t *src, int n);
+
+static alpha_span_fn g_over_span;
+static const char *g_kernel_name = "sse2";
+
+static struct alpha_shadow_profile g_shadow_cache[ALPHA_SHADOW_CACHE];
+static uint32_t g_shadow_clock;
+
+static inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t over_pixel(uint32_t d, uint32_t s) {
+    uint32_t a = s >> 24;
+    if (a == 255) return s & 0x00FFFFFFU;
+    if (a == 0) return d;
+
+    uint32_t ia = 255 - a;
+    uint32_t r = ((s >> 16) & 0xFF) + div255(((d >> 16) & 0xFF) * ia);
+    uint32_t g = ((s >> 8) & 0xFF) + div255(((d >> 8) & 0xFF) * ia);
+    uint32_t b = (s & 0xFF) + div255((d & 0xFF) * ia);
+    return (r << 16) | (g << 8) | b;
+}
+
+uint32_t alpha_premultiply(uint32_t rgb, uint32_t alpha) {
+    if (alpha >= 255) return 0xFF000000U | (rgb & 0x00FFFFFFU);
+    uint32_t r = div255(((rgb >> 16) & 0xFF) * alpha);
+    uint32_t g = div255(((rgb >> 8) & 0xFF) * alpha);
+    uint32_t b = div255((rgb & 0xFF) * alpha);
+    return (alpha << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Blends 2 pixels worth of 16-bit lanes: d * (255 - a) / 255.
+static inline __m128i scale_sse2(__m128i d16, __m128i ia16) {
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(d16, ia16), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static void over_span_sse2(uint32_t *dst, const uint32_t *src, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi32(255);
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i a = _mm_srli_epi32(s, 24);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, c255)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(s, rgb_mask));
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xFFFF) {
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i ia = _mm_sub_epi32(c255, a);
+        ia = _mm_or_si128(ia, _mm_slli_epi32(ia, 16));
+        __m128i lo = scale_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(ia, ia));
+        __m128i hi = scale_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(ia, ia));
+        __m128i out = _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(out, rgb_mask));
+    }
+
+    for (; i < n; i++) {
+        dst[i] = over_pixel(dst[i], src[i]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void over_span_avx2(uint32_t *dst, const uint32_t *src, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi32(255);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    const __m256i rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i a = _mm256_srli_epi32(s, 24);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, c255)) == -1) {
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(s, rgb_mask));
+            continue;
+        }
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, zero)) == -1) {
+            continue;
+        }
+
+        // Unpack/pack work per 128-bit lane, so pixel order is preserved.
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i ia = _mm256_sub_epi32(c255, a);
+        ia = _mm256_or_si256(ia, _mm256_slli_epi32(ia, 16));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi32(ia, ia)), c128);
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi32(ia, ia)), c128);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+        __m256i out = _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(out, rgb_mask));
+    }
+
+    if (i < n) {
+        over_span_sse2(dst + i, src + i, n - i);
+    }
+}
+
+static void cpuid(uint32_t leaf, uint32_t sub, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    __asm__ volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(sub));
+}
+
+static int cpu_has_avx2(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a < 7) return 0;
+
+    // AVX needs OS-managed YMM state (OSXSAVE + XCR0 bits 1 and 2).
+    cpuid(1, 0, &a, &b, &c, &d);
+    if (!(c & (1U << 27)) || !(c & (1U << 28))) return 0;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6U) != 0x6U) return 0;
+
+    cpuid(7, 0, &a, &b, &c, &d);
+    return (b & (1U << 5)) != 0;
+}
+
+void alpha_init(void) {
+    if (cpu_has_avx2()) {
+        g_over_span = over_span_avx2;
+        g_kernel_name = "avx2";
+    } else {
+        g_over_span = over_span_sse2;
+        g_kernel_name = "sse2";
+    }
+}
+
+const char *alpha_kernel_name(void) {
+    return g_kernel_name;
+}
+
+void alpha_over_span(uint32_t *dst, const uint32_t *src, int n) {
+    if (n <= 0) return;
+    if (!g_over_span) alpha_init();
+    g_over_span(dst, src, n);
+}
+
+// Three box passes approximate a Gaussian of the box indicator.
+static void blur_profile(uint8_t *out, int size, int radius) {
+    static int buf_a[ALPHA_SHADOW_MAX_LEN];
+    static int buf_b[ALPHA_SHADOW_MAX_LEN];
+    int len = size + 2 * radius;
+    for (int i = 0; i < len; i++) {
+        buf_a[i] = (i >= radius && i < radius + size) ? 255 : 0;
+    }
+
+    int half = radius / 3;
+    if (half < 1) half = 1;
+    int width = 2 * half + 1;
+    int *in = buf_a;
+    int *tmp = buf_b;
+    for (int pass = 0; pass < 3; pass++) {
+        int sum = 0;
+        for (int i = -half; i <= half; i++) {
+            if (i >= 0 && i < len) sum += in[i];
+        }
+        for (int i = 0; i < len; i++) {
+            tmp[i] = sum / width;
+            int drop = i - half;
+            int add = i + half + 1;
+            if (drop >= 0) sum -= in[drop];
+            if (add < len) sum += in[add];
+        }
+        int *swap = in;
+        in = tmp;
+        tmp = swap;
+    }
+
+    for (int i = 0; i < len; i++) {
+        out[i] = (uint8_t)(in[i] > 255 ? 255 : in[i]);
+    }
+}
+
+const struct alpha_shadow_profile *alpha_shadow_profile(int w, int h, int radius) {
+    if (w <= 0 || h <= 0 || radius <= 0 || radius > ALPHA_SHADOW_MAX_RADIUS) return 0;
+    if (w + 2 * radius > ALPHA_SHADOW_MAX_LEN || h + 2 * radius > ALPHA_SHADOW_MAX_LEN) return 0;
+
+    struct alpha_shadow_profile *victim = &g_shadow_cache[0];
+    for (int i = 0; i < ALPHA_SHADOW_CACHE; i++) {
+        struct alpha_shadow_profile *p = &g_shadow_cache[i];
+        if (p->radius == radius && p->w == w && p->h == h) {
+            p->last_used = ++g_shadow_clock;
+            return p;
+        }
+        if (p->last_used < victim->last_used) {
+            victim = p;
+        }
+    }
+
+    blur_profile(victim->px, w, radius);
+    blur_profile(victim->py, h, radius);
+    victim->w = w;
+    victim->h = h;
+    victim->radius = radius;
+    victim->last_used = ++g_shadow_clock;
+    return victim;
+}
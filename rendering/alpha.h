@@ -0,0 +1,42 @@
+#ifndef RENDERING_ALPHA_H
+#define RENDERING_ALPHA_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Premultiplied-alpha compositing kernels. Sources are 0xAARRGGBB with colour
+// already scaled by alpha; destinations are 0x00RRGGBB rows. Spans of fully
+// opaque (or fully transparent) pixels skip the blend arithmetic.
+#define ALPHA_SHADOW_MAX_RADIUS 64
+#define ALPHA_SHADOW_MAX_LEN (4096 + 2 * ALPHA_SHADOW_MAX_RADIUS)
+#define ALPHA_SHADOW_CACHE 8
+
+// Picks the widest kernel the CPU and OS support (AVX2, else SSE2).
+void alpha_init(void);
+const char *alpha_kernel_name(void);
+
+void alpha_over_span(uint32_t *dst, const uint32_t *src, int n);
+uint32_t alpha_premultiply(uint32_t rgb, uint32_t alpha);
+
+// Blurred shadow coverage for a w x h box, as separable 1D profiles of
+// w + 2 * radius and h + 2 * radius samples (0..255). Blurred once per size
+// and kept in a small LRU cache.
+struct alpha_shadow_profile {
+    int w;
+    int h;
+    int radius;
+    uint32_t last_used;
+    uint8_t px[ALPHA_SHADOW_MAX_LEN];
+    uint8_t py[ALPHA_SHADOW_MAX_LEN];
+};
+
+const struct alpha_shadow_profile *alpha_shadow_profile(int w, int h, int radius);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+#include "capture.h"
+#include "convert.h"
+#include "rendering.h"
+#include "trace.h"
+#include "util.h"
+#include <libsys.h>
+
+#define CAPTURE_OUT_BYTES (64 * 1024)
+#define CAPTURE_TICKS_PER_SECOND 100U
+
+static int g_fd = -1;
+static int g_keyframe_interval;
+static uint32_t g_frame_index;
+static uint64_t g_start_ticks;
+static uint64_t g_start_tsc;
+static struct capture_stats g_stats;
+
+static uint8_t g_out[CAPTURE_OUT_BYTES];
+static int g_out_len;
+static uint32_t g_row[CAPTURE_MAX_WIDTH];
+
+static void flush_out(void) {
+    if (g_fd < 0) {
+        g_out_len = 0;
+        return;
+    }
+
+    int done = 0;
+    while (done < g_out_len) {
+        int n = write(g_fd, &g_out[done], g_out_len - done);
+        if (n <= 0) {
+            // The reader went away or the disk is full: stop recording.
+            print("[deimos] capture: write failed, stopping\n");
+            close(g_fd);
+            g_fd = -1;
+            break;
+        }
+        done += n;
+    }
+    g_stats.bytes += (uint64_t)done;
+    g_out_len = 0;
+}
+
+static void put_u8(uint32_t v) {
+    if (g_out_len >= CAPTURE_OUT_BYTES) flush_out();
+    g_out[g_out_len++] = (uint8_t)v;
+}
+
+static void put_u16(uint32_t v) {
+    put_u8(v & 0xFF);
+    put_u8((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint32_t v) {
+    put_u16(v & 0xFFFF);
+    put_u16(v >> 16);
+}
+
+static void put_magic(const char *m) {
+    for (int i = 0; i < 4; i++) put_u8((uint8_t)m[i]);
+}
+
+static uint32_t fnv_word(uint32_t h, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        h ^= (v >> (i * 8)) & 0xFF;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static void encode_rect(const struct render_rect *r) {
+    const uint8_t *fb = render_backbuffer();
+    int format = render_format();
+    int bytes = render_format_bytes(format);
+    int pitch = render_pitch();
+
+    put_u16((uint32_t)r->x);
+    put_u16((uint32_t)r->y);
+    put_u16((uint32_t)r->w);
+    put_u16((uint32_t)r->h);
+
+    uint32_t index[64];
+    for (int i = 0; i < 64; i++) index[i] = 0xFFFFFFFFU; // never matches XRGB
+    uint32_t prev = 0;
+    uint32_t hash = 2166136261U;
+    int run = 0;
+
+    for (int y = r->y; y < r->y + r->h; y++) {
+        render_unpack_span(format, g_row, fb + (long)y * pitch + (long)r->x * bytes, r->w);
+        for (int x = 0; x < r->w; x++) {
+            uint32_t px = g_row[x];
+            hash = fnv_word(hash, px);
+
+            if (px == prev) {
+                if (++run == 62) {
+                    put_u8(0xC0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                put_u8(0xC0 | (run - 1));
+                run = 0;
+            }
+
+            int pr = (int)((px >> 16) & 0xFF);
+            int pg = (int)((px >> 8) & 0xFF);
+            int pb = (int)(px & 0xFF);
+            int slot = (pr * 3 + pg * 5 + pb * 7 + 255 * 11) % 64;
+            if (index[slot] == px) {
+                put_u8((uint32_t)slot);
+            } else {
+                index[slot] = px;
+                int dr = (int)(int8_t)(uint8_t)(pr - (int)((prev >> 16) & 0xFF));
+                int dg = (int)(int8_t)(uint8_t)(pg - (int)((prev >> 8) & 0xFF));
+                int db = (int)(int8_t)(uint8_t)(pb - (int)(prev & 0xFF));
+                int dr_dg = dr - dg;
+                int db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    put_u8(0x40 | (uint32_t)((dr + 2) << 4) | (uint32_t)((dg + 2) << 2) | (uint32_t)(db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    put_u8(0x80 | (uint32_t)(dg + 32));
+                    put_u8((uint32_t)((dr_dg + 8) << 4) | (uint32_t)(db_dg + 8));
+                } else {
+                    put_u8(0xFE);
+                    put_u8((uint32_t)pr);
+                    put_u8((uint32_t)pg);
+                    put_u8((uint32_t)pb);
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0) put_u8(0xC0 | (run - 1));
+    put_u32(hash);
+    g_stats.pixels += (uint64_t)r->w * (uint64_t)r->h;
+}
+
+int capture_start(const char *path, int keyframe_interval) {
+    if (!path || !path[0] || g_fd >= 0) return -1;
+    if (render_width() > CAPTURE_MAX_WIDTH || !render_backbuffer()) return -1;
+
+    g_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (g_fd < 0) {
+        print("[deimos] capture: cannot open ");
+        print(path);
+        print("\n");
+        return -1;
+    }
+
+    g_keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    g_frame_index = 0;
+    g_out_len = 0;
+    g_stats.frames = 0;
+    g_stats.keyframes = 0;
+    g_stats.bytes = 0;
+    g_stats.pixels = 0;
+    g_stats.encode_cycles = 0;
+    g_start_ticks = ticks();
+    g_start_tsc = deimos_tsc();
+
+    put_magic(CAPTURE_MAGIC);
+    put_u32(CAPTURE_VERSION);
+    put_u32((uint32_t)render_width());
+    put_u32((uint32_t)render_height());
+    print("[deimos] capture: recording to ");
+    print(path);
+    print("\n");
+    return 0;
+}
+
+int capture_active(void) {
+    return g_fd >= 0;
+}
+
+void capture_frame(void) {
+    if (g_fd < 0) return;
+
+    int key = (g_frame_index % (uint32_t)g_keyframe_interval) == 0;
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+    int count;
+    // Like render_present_dirty, a frame without damage presented everything.
+    if (key || !render_has_dirty()) {
+        rects[0].x = 0;
+        rects[0].y = 0;
+        rects[0].w = render_width();
+        rects[0].h = render_height();
+        count = 1;
+    } else {
+        count = render_damage_clip(0, 0, render_width(), render_height(), rects, RENDER_MAX_DIRTY_RECTS);
+        if (count <= 0) return;
+    }
+
+    uint64_t begin = deimos_tsc();
+    put_magic(CAPTURE_FRAME_MAGIC);
+    put_u32(g_frame_index);
+    put_u32((uint32_t)(ticks() - g_start_ticks));
+    put_u16(key ? CAPTURE_FLAG_KEYFRAME : 0);
+    put_u16((uint32_t)count);
+    for (int i = 0; i < count; i++) {
+        encode_rect(&rects[i]);
+    }
+    g_stats.encode_cycles += deimos_tsc() - begin;
+    DEIMOS_TRACE2(CAPTURE, g_frame_index, count);
+
+    g_frame_index++;
+    g_stats.frames++;
+    if (key) g_stats.keyframes++;
+}
+
+void capture_get_stats(struct capture_stats *out) {
+    if (!out) return;
+    *out = g_stats;
+    out->bytes += (uint64_t)g_out_len;
+}
+
+void capture_stop(void) {
+    if (g_fd < 0) return;
+    flush_out();
+    if (g_fd >= 0) {
+        close(g_fd);
+        g_fd = -1;
+    }
+
+    // Encode time is measured in TSC cycles and converted with the TSC rate
+    // observed over the whole recording.
+    uint64_t elapsed_ticks = ticks() - g_start_ticks;
+    uint64_t tsc_per_second = 0;
+    if (elapsed_ticks > 0) {
+        tsc_per_second = ((deimos_tsc() - g_start_tsc) / elapsed_ticks) * CAPTURE_TICKS_PER_SECOND;
+    }
+    uint32_t kpx_per_second = 0;
+    if (g_stats.encode_cycles > 0 && tsc_per_second > 0) {
+        kpx_per_second = (uint32_t)((g_stats.pixels * (tsc_per_second / 1000U)) / g_stats.encode_cycles);
+    }
+    uint32_t per_frame = g_stats.frames ? (uint32_t)(g_stats.bytes / g_stats.frames) : 0;
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] capture: ");
+    n = deimos_append_u32(line, n, g_stats.frames);
+    n = deimos_append_str(line, n, " frames (");
+    n = deimos_append_u32(line, n, g_stats.keyframes);
+    n = deimos_append_str(line, n, " key), ");
+    n = deimos_append_u32(line, n, per_frame);
+    n = deimos_append_str(line, n, " bytes/frame, encode ");
+    n = deimos_append_u32(line, n, kpx_per_second);
+    n = deimos_append_str(line, n, " kpx/s\n");
+    line[n] = '\0';
+    print(line);
+}
@@ -0,0 +1,50 @@
+#ifndef RENDERING_CAPTURE_H
+#define RENDERING_CAPTURE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Damage-driven screen capture. Every presented frame appends only its damaged
+// rects, so an idle desktop records nothing; every `keyframe_interval` frames
+// (and the first) the whole screen is written instead.
+//
+// Stream layout (little endian), decoded by tools/dcap_decode.c:
+//   header: "DCAP", u32 version, u32 width, u32 height
+//   frame:  "FRAM", u32 index, u32 ticks, u16 flags, u16 rect_count
+//   rect:   u16 x, y, w, h, QOI-style ops for w*h pixels, u32 FNV-1a of the
+//           rect's 0x00RRGGBB pixels (row-major, little endian words)
+// Rect ops reset per rect (previous pixel 0x000000, empty index):
+//   00iiiiii index, 01rrggbb diff (-2..1), 10gggggg + rrrrbbbb luma,
+//   11rrrrrr run of 1..62, 0xFE r g b literal. Alpha is always 255.
+#define CAPTURE_MAGIC "DCAP"
+#define CAPTURE_FRAME_MAGIC "FRAM"
+#define CAPTURE_VERSION 1
+#define CAPTURE_FLAG_KEYFRAME 1
+#define CAPTURE_MAX_WIDTH 4096
+
+struct capture_stats {
+    uint32_t frames;
+    uint32_t keyframes;
+    uint64_t bytes;
+    uint64_t pixels;
+    uint64_t encode_cycles;
+};
+
+// Opens `path` (file or pipe) and starts recording. Returns 0 on success.
+int capture_start(const char *path, int keyframe_interval);
+// Encodes the damage of the frame just presented; call before
+// render_reset_dirty. No-op when not recording.
+void capture_frame(void);
+// Flushes, closes and logs frame count, bytes per frame and throughput.
+void capture_stop(void);
+int capture_active(void);
+void capture_get_stats(struct capture_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+#include "convert.h"
+#include <emmintrin.h>
+
+static const uint8_t BAYER4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5}
+};
+
+int render_format_bytes(int format) {
+    if (format == RENDER_FORMAT_RGB565) return 2;
+    if (format == RENDER_FORMAT_RGB888) return 3;
+    return 4;
+}
+
+int render_format_for_bpp(int bpp) {
+    if (bpp == 16) return RENDER_FORMAT_RGB565;
+    if (bpp == 24) return RENDER_FORMAT_RGB888;
+    return RENDER_FORMAT_XRGB8888;
+}
+
+static inline uint32_t add_sat8(uint32_t v, uint32_t add) {
+    v += add;
+    return v > 255 ? 255 : v;
+}
+
+static inline uint16_t pack565(uint32_t xrgb, int dither, int x, int y) {
+    uint32_t r = (xrgb >> 16) & 0xFF;
+    uint32_t g = (xrgb >> 8) & 0xFF;
+    uint32_t b = xrgb & 0xFF;
+    if (dither) {
+        uint32_t m = BAYER4[y & 3][x & 3];
+        r = add_sat8(r, m >> 1);
+        g = add_sat8(g, m >> 2);
+        b = add_sat8(b, m >> 1);
+    }
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+uint32_t render_convert_pixel(int format, uint32_t xrgb) {
+    if (format == RENDER_FORMAT_RGB565) return pack565(xrgb, 0, 0, 0);
+    return xrgb & 0x00FFFFFFU;
+}
+
+uint32_t render_unpack_pixel(int format, const uint8_t *p) {
+    if (format == RENDER_FORMAT_RGB565) {
+        uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+        uint32_t r = (v >> 11) & 0x1F;
+        uint32_t g = (v >> 5) & 0x3F;
+        uint32_t b = v & 0x1F;
+        return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+    }
+    if (format == RENDER_FORMAT_RGB888) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    }
+    return *(const uint32_t *)p & 0x00FFFFFFU;
+}
+
+static inline __m128i pack565_lanes(__m128i p) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F));
+    __m128i v = _mm_or_si128(_mm_or_si128(r, g), b);
+    // Sign-extend the low halves so the signed pack keeps all 16 bits.
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+// Per-byte Bayer offsets for 4 pixels of row y starting at column x0.
+static __m128i bayer_lanes(int x0, int y) {
+    uint32_t lanes[4];
+    for (int i = 0; i < 4; i++) {
+        uint32_t m = BAYER4[y & 3][(x0 + i) & 3];
+        lanes[i] = ((m >> 1) << 16) | ((m >> 2) << 8) | (m >> 1);
+    }
+    return _mm_set_epi32((int)lanes[3], (int)lanes[2], (int)lanes[1], (int)lanes[0]);
+}
+
+static void convert_span_565(uint16_t *dst, const uint32_t *src, int n, int dither, int x0, int y) {
+    __m128i thr = dither ? bayer_lanes(x0, y) : _mm_setzero_si128();
+    int i = 0;
+
+    // The Bayer pattern repeats every 4 columns, so one vector covers both halves.
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + i)), thr);
+        __m128i b = _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + i + 4)), thr);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(pack565_lanes(a), pack565_lanes(b)));
+    }
+
+    for (; i < n; i++) {
+        dst[i] = pack565(src[i], dither, x0 + i, y);
+    }
+}
+
+static void unpack_span_565(uint32_t *dst, const uint16_t *src, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i halves[2];
+        halves[0] = _mm_unpacklo_epi16(v, zero);
+        halves[1] = _mm_unpackhi_epi16(v, zero);
+        for (int h = 0; h < 2; h++) {
+            __m128i w = halves[h];
+            __m128i r = _mm_and_si128(_mm_srli_epi32(w, 11), _mm_set1_epi32(0x1F));
+            __m128i g = _mm_and_si128(_mm_srli_epi32(w, 5), _mm_set1_epi32(0x3F));
+            __m128i b = _mm_and_si128(w, _mm_set1_epi32(0x1F));
+            r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+            g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+            b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+            __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)), b);
+            _mm_storeu_si128((__m128i *)(dst + i + h * 4), out);
+        }
+    }
+
+    for (; i < n; i++) {
+        dst[i] = render_unpack_pixel(RENDER_FORMAT_RGB565, (const uint8_t *)(src + i));
+    }
+}
+
+void render_convert_span(int format, void *dst, const uint32_t *src, int n, int dither, int x0, int y) {
+    if (n <= 0) return;
+
+    if (format == RENDER_FORMAT_RGB565) {
+        convert_span_565((uint16_t *)dst, src, n, dither, x0, y);
+        return;
+    }
+
+    if (format == RENDER_FORMAT_RGB888) {
+        uint8_t *out = (uint8_t *)dst;
+        for (int i = 0; i < n; i++) {
+            out[i * 3 + 0] = (uint8_t)src[i];
+            out[i * 3 + 1] = (uint8_t)(src[i] >> 8);
+            out[i * 3 + 2] = (uint8_t)(src[i] >> 16);
+        }
+        return;
+    }
+
+    uint32_t *out = (uint32_t *)dst;
+    const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_and_si128(v, mask));
+    }
+    for (; i < n; i++) {
+        out[i] = src[i] & 0x00FFFFFFU;
+    }
+}
+
+void render_unpack_span(int format, uint32_t *dst, const void *src, int n) {
+    if (n <= 0) return;
+
+    if (format == RENDER_FORMAT_RGB565) {
+        unpack_span_565(dst, (const uint16_t *)src, n);
+        return;
+    }
+
+    const uint8_t *in = (const uint8_t *)src;
+    int bytes = render_format_bytes(format);
+    for (int i = 0; i < n; i++) {
+        dst[i] = render_unpack_pixel(format, in + i * bytes);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef RENDERING_CONVERT_H
+#define RENDERING_CONVERT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pixel formats for surfaces and the framebuffer. XRGB8888 is the canonical
+// 0x00RRGGBB form content is authored in; the others match 24/16 bpp modes.
+#define RENDER_FORMAT_XRGB8888 0
+#define RENDER_FORMAT_RGB888 1
+#define RENDER_FORMAT_RGB565 2
+
+int render_format_bytes(int format);
+int render_format_for_bpp(int bpp);
+
+uint32_t render_convert_pixel(int format, uint32_t xrgb);
+uint32_t render_unpack_pixel(int format, const uint8_t *p);
+
+// XRGB -> format. With `dither`, RGB565 output uses a 4x4 ordered (Bayer)
+// pattern anchored at (x0, y), so the same content converts identically.
+void render_convert_span(int format, void *dst, const uint32_t *src, int n, int dither, int x0, int y);
+// format -> XRGB.
+void render_unpack_span(int format, uint32_t *dst, const void *src, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,23 +1,127 @@
 #include "rendering.h"
+#include "alpha.h"
+#include "convert.h"
+#include "trace.h"
 #include <libsys.h>
 
-static struct user_fb_info g_fb;
-static uint8_t *backbuffer;
-static uint32_t g_bytes_per_pixel;
-static uint32_t g_pitch;
+// Frames are composed in system memory and copied out by fb_present*, so
+// blending and snapshots read cached RAM instead of the mapped framebuffer.
+// Present buffers, virtual outputs and other frame-sized buffers are carved
+// from this pool at start-up, sized to the real mode and only for what is
+// configured (render_frame_alloc). A mode whose buffers do not fit falls back
+// to drawing into the mapping directly. Build with FRAME_POOL_MB to resize.
+#ifndef RENDER_FRAME_POOL_MB
+#define RENDER_FRAME_POOL_MB 32
+#endif
+#define RENDER_FRAME_POOL_BYTES ((uint32_t)RENDER_FRAME_POOL_MB * 1024U * 1024U)
 
-#define RENDER_MAX_DIRTY_RECTS 128
+// Present pipeline: a submitted frame is frozen in one system-memory buffer
+// and copied to the framebuffer in slices by render_present_pump, while
+// the next frame is drawn into another buffer. A buffer whose copy-out is
+// still pending is drained before it is drawn into again (back-pressure).
+#define RENDER_PRESENT_BUFFERS 3
 
-struct render_dirty_rect {
-    int x;
-    int y;
-    int w;
-    int h;
+// Damage of the last few submitted frames. A buffer that last held frame k
+// is brought up to frame n by copying the damage of frames k+1..n forward
+// (its age is n - k), so the backbuffer always holds the latest frame. Older
+// buffers, or ones never drawn, are copied in full.
+#define RENDER_DAMAGE_HISTORY 4
+
+struct present_job {
+    int buffer;
+    int count;
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+    int rect_index; // progress: next rect and row within it
+    int row;
+};
+
+struct damage_frame {
+    int count;
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+};
+
+// Everything one output draws, damages and presents with. Public coordinates
+// are desktop coordinates; an output covers (origin, fb.width x fb.height)
+// of the desktop and its buffers are indexed relative to the origin.
+struct render_target {
+    struct user_fb_info fb;
+    int origin_x;
+    int origin_y;
+    uint8_t *front; // virtual outputs: presented pixels; 0 for the framebuffer
+
+    uint8_t *backbuffer;
+    uint8_t *buffers[RENDER_PRESENT_BUFFERS];
+    int buffer_count;
+    int current;
+
+    struct present_job jobs[RENDER_PRESENT_BUFFERS];
+    int job_head;
+    int job_count;
+    struct render_present_stats present_stats;
+
+    struct damage_frame history[RENDER_DAMAGE_HISTORY];
+    uint32_t frame_serial; // frames submitted so far
+    uint32_t buffer_serial[RENDER_PRESENT_BUFFERS]; // frame held; 0 = undefined
+    uint32_t bytes_per_pixel;
+    uint32_t pitch;
+    int format;
+
+    struct render_rect dirty_rects[RENDER_MAX_DIRTY_RECTS];
+    int dirty_count;
+    int full_dirty;
+
+    // Optional native-format image (render_pitch layout) cleared areas copy from.
+    const uint8_t *background;
+
+    // Overdraw debugging (render_set_overdraw). Overlay pixels drawn over a
+    // frame's damage are repainted by the next frame; that cleanup damage
+    // (the first stale_count dirty rects, or full damage if stale_full) is
+    // not itself overlaid, so the overlay never feeds on itself.
+    struct render_overdraw_stats overdraw_stats;
+    struct render_rect overlay_rects[RENDER_MAX_DIRTY_RECTS];
+    int overlay_count;
+    int overlay_full;
+    int stale_count;
+    int stale_full;
 };
 
-static struct render_dirty_rect g_dirty_rects[RENDER_MAX_DIRTY_RECTS];
-static int g_dirty_count;
-static int g_full_dirty = 1;
+static uint8_t g_frame_pool[RENDER_FRAME_POOL_BYTES] __attribute__((aligned(64)));
+static uint32_t g_frame_pool_used;
+static int g_requested_buffers = 2;
+static uint32_t g_background_serial;
+static int g_ui_scale = 1;
+
+static struct render_target g_targets[RENDER_MAX_OUTPUTS];
+static int g_target_count;
+static struct render_target *g_target = &g_targets[0];
+
+// Damage verification: the full repaint lands in g_verify_buffer while the
+// bound output's incremental frame and damage are parked here. The buffer
+// comes from the frame pool the first time verification runs.
+static uint8_t *g_verify_buffer;
+static uint32_t g_verify_bytes;
+static struct {
+    int active;
+    uint8_t *incremental;
+    struct render_rect dirty_rects[RENDER_MAX_DIRTY_RECTS];
+    int dirty_count;
+    int full_dirty;
+    int counting; // overdraw counting, paused for the repaint
+} g_verify;
+
+// Per-pixel write counts of the frame being drawn (output-local, row-major,
+// saturating at OVERDRAW_COUNT_MAX) and the damaged pixels as they were
+// before it, to tell changed pixels from merely presented ones. Both come
+// from the frame pool the first time a frame is measured.
+#define OVERDRAW_COUNT_MAX 0x3F
+#define OVERDRAW_CHANGED 0x80 // credited as changed once, despite overlapping rects
+#define OVERDRAW_TINTED 0x40  // heat already blended in
+static uint8_t *g_overdraw_counts;
+static uint32_t g_overdraw_counts_bytes;
+static uint8_t *g_overdraw_before;
+static uint32_t g_overdraw_before_bytes;
+static int g_overdraw_mode;
+static int g_overdraw_counting; // from render_begin_frame to render_present_dirty
 
 static const uint8_t GLYPH_SPACE[7] = {0, 0, 0, 0, 0, 0, 0};
 static const uint8_t GLYPH_COLON[7] = {0x00, 0x04, 0x04, 0x00, 0x04, 0x04, 0x00};
@@ -34,6 +138,12 @@ static const uint8_t GLYPH_9[7] = {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x1C};
 static const uint8_t GLYPH_F[7] = {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10};
 static const uint8_t GLYPH_P[7] = {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10};
 static const uint8_t GLYPH_S[7] = {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E};
+static const uint8_t GLYPH_B[7] = {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E};
+static const uint8_t GLYPH_D[7] = {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C};
+static const uint8_t GLYPH_K[7] = {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11};
+static const uint8_t GLYPH_O[7] = {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E};
+static const uint8_t GLYPH_W[7] = {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A};
+static const uint8_t GLYPH_DOT[7] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C};
 
 static const uint8_t *render_glyph_for_char(char c) {
     switch (c) {
@@ -52,33 +162,60 @@ static const uint8_t *render_glyph_for_char(char c) {
         case 'F': return GLYPH_F;
         case 'P': return GLYPH_P;
         case 'S': return GLYPH_S;
+        case 'B': return GLYPH_B;
+        case 'D': return GLYPH_D;
+        case 'K': return GLYPH_K;
+        case 'O': return GLYPH_O;
+        case 'W': return GLYPH_W;
+        case '.': return GLYPH_DOT;
         default:  return GLYPH_SPACE;
     }
 }
 
-static void render_store_pixel(int x, int y, uint32_t colour) {
-    uint8_t *p = backbuffer + ((uint32_t)y * g_pitch) + ((uint32_t)x * g_bytes_per_pixel);
-
-    if (g_fb.bpp == 16) {
-        uint8_t r = (uint8_t)((colour >> 16) & 0xFF);
-        uint8_t g = (uint8_t)((colour >> 8) & 0xFF);
-        uint8_t b = (uint8_t)(colour & 0xFF);
-        uint16_t rgb565 = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
-        *(uint16_t *)p = rgb565;
+// Address of desktop pixel (x, y) in one of the bound output's buffers.
+static uint8_t *target_pixel(uint8_t *buffer, int x, int y) {
+    return buffer + (uint32_t)(y - g_target->origin_y) * g_target->pitch +
+           (uint32_t)(x - g_target->origin_x) * g_target->bytes_per_pixel;
+}
+
+// Counts a write of the (already clipped) rect while overdraw is measured.
+static void overdraw_count(int x, int y, int w, int h) {
+    if (!g_overdraw_counting || w <= 0 || h <= 0) return;
+    g_target->overdraw_stats.writes += (uint64_t)w * (uint64_t)h;
+    uint8_t *row = &g_overdraw_counts[(uint32_t)(y - g_target->origin_y) * g_target->fb.width +
+                                      (uint32_t)(x - g_target->origin_x)];
+    for (int yy = 0; yy < h; yy++) {
+        for (int i = 0; i < w; i++) {
+            if (row[i] < OVERDRAW_COUNT_MAX) row[i]++;
+        }
+        row += g_target->fb.width;
+    }
+}
+
+static void render_store_native(int x, int y, uint32_t native) {
+    overdraw_count(x, y, 1, 1);
+    uint8_t *p = target_pixel(g_target->backbuffer, x, y);
+
+    if (g_target->bytes_per_pixel == 2) {
+        *(uint16_t *)p = (uint16_t)native;
         return;
     }
 
-    if (g_fb.bpp == 24) {
-        p[0] = (uint8_t)(colour & 0xFF);
-        p[1] = (uint8_t)((colour >> 8) & 0xFF);
-        p[2] = (uint8_t)((colour >> 16) & 0xFF);
+    if (g_target->bytes_per_pixel == 3) {
+        p[0] = (uint8_t)(native & 0xFF);
+        p[1] = (uint8_t)((native >> 8) & 0xFF);
+        p[2] = (uint8_t)((native >> 16) & 0xFF);
         return;
     }
 
-    *(uint32_t *)p = colour;
+    *(uint32_t *)p = native;
 }
 
-static int render_clip_rect(int x, int y, int w, int h, struct render_dirty_rect *out) {
+static void render_store_pixel(int x, int y, uint32_t colour) {
+    render_store_native(x, y, render_convert_pixel(g_target->format, colour));
+}
+
+static int render_clip_rect(int x, int y, int w, int h, struct render_rect *out) {
     if (w <= 0 || h <= 0 || !out) {
         return 0;
     }
@@ -88,10 +225,12 @@ static int render_clip_rect(int x, int y, int w, int h, struct render_dirty_rect
     int x1 = x + w;
     int y1 = y + h;
 
-    if (x0 < 0) x0 = 0;
-    if (y0 < 0) y0 = 0;
-    if (x1 > (int)g_fb.width) x1 = (int)g_fb.width;
-    if (y1 > (int)g_fb.height) y1 = (int)g_fb.height;
+    int ox = g_target->origin_x;
+    int oy = g_target->origin_y;
+    if (x0 < ox) x0 = ox;
+    if (y0 < oy) y0 = oy;
+    if (x1 > ox + (int)g_target->fb.width) x1 = ox + (int)g_target->fb.width;
+    if (y1 > oy + (int)g_target->fb.height) y1 = oy + (int)g_target->fb.height;
 
     if (x1 <= x0 || y1 <= y0) {
         return 0;
@@ -104,21 +243,62 @@ static int render_clip_rect(int x, int y, int w, int h, struct render_dirty_rect
     return 1;
 }
 
-static void render_fill_rect_clamped(int x, int y, int w, int h, uint32_t colour) {
-    struct render_dirty_rect r;
+// The bound output's whole area, in desktop coordinates.
+static void target_bounds(struct render_rect *out) {
+    out->x = g_target->origin_x;
+    out->y = g_target->origin_y;
+    out->w = (int)g_target->fb.width;
+    out->h = (int)g_target->fb.height;
+}
+
+static void copy_rect(uint8_t *dst, const uint8_t *src, const struct render_rect *r) {
+    uint32_t offset = (uint32_t)(target_pixel(dst, r->x, r->y) - dst);
+    int bytes = r->w * (int)g_target->bytes_per_pixel;
+    int words = bytes / 8;
+    for (int y = 0; y < r->h; y++) {
+        uint8_t *d = dst + offset;
+        const uint8_t *s = src + offset;
+        for (int i = 0; i < words; i++) {
+            ((uint64_t *)d)[i] = ((const uint64_t *)s)[i];
+        }
+        for (int i = words * 8; i < bytes; i++) {
+            d[i] = s[i];
+        }
+        offset += g_target->pitch;
+    }
+}
+
+// Fills with an already-converted framebuffer value, one row at a time.
+static void render_fill_native_clamped(int x, int y, int w, int h, uint32_t native) {
+    struct render_rect r;
     if (!render_clip_rect(x, y, w, h, &r)) {
         return;
     }
 
-    int x_end = r.x + r.w;
+    overdraw_count(r.x, r.y, r.w, r.h);
     int y_end = r.y + r.h;
     for (int yy = r.y; yy < y_end; yy++) {
-        for (int xx = r.x; xx < x_end; xx++) {
-            render_store_pixel(xx, yy, colour);
+        uint8_t *row = target_pixel(g_target->backbuffer, r.x, yy);
+        if (g_target->bytes_per_pixel == 4) {
+            uint32_t *px = (uint32_t *)row;
+            for (int i = 0; i < r.w; i++) px[i] = native;
+        } else if (g_target->bytes_per_pixel == 2) {
+            uint16_t *px = (uint16_t *)row;
+            for (int i = 0; i < r.w; i++) px[i] = (uint16_t)native;
+        } else {
+            for (int i = 0; i < r.w; i++) {
+                row[i * 3 + 0] = (uint8_t)(native & 0xFF);
+                row[i * 3 + 1] = (uint8_t)((native >> 8) & 0xFF);
+                row[i * 3 + 2] = (uint8_t)((native >> 16) & 0xFF);
+            }
         }
     }
 }
 
+static void render_fill_rect_clamped(int x, int y, int w, int h, uint32_t colour) {
+    render_fill_native_clamped(x, y, w, h, render_convert_pixel(g_target->format, colour));
+}
+
 static int render_rects_overlap(int ax, int ay, int aw, int ah,
                                 int bx, int by, int bw, int bh) {
     if (aw <= 0 || ah <= 0 || bw <= 0 || bh <= 0) return 0;
@@ -132,74 +312,295 @@ static int render_rects_overlap(int ax, int ay, int aw, int ah,
 }
 
 int render_init(void) {
+    g_target = &g_targets[0];
+    g_target_count = 1;
+    g_frame_pool_used = 0;
+    g_verify_buffer = 0;
+    g_verify_bytes = 0;
+    g_overdraw_counts = 0;
+    g_overdraw_counts_bytes = 0;
+    g_overdraw_before = 0;
+    g_overdraw_before_bytes = 0;
+
     print("[deimos] render_init: fb_info\n");
-    int rc = fb_info(&g_fb);
+    int rc = fb_info(&g_target->fb);
     if (rc != 0) {
         print("[deimos] render_init: fb_info failed\n");
         return -1;
     }
-    if (g_fb.width == 0 || g_fb.height == 0) {
+    if (g_target->fb.width == 0 || g_target->fb.height == 0) {
         print("[deimos] render_init: bad dimensions\n");
         return -1;
     }
-    if (g_fb.bpp != 16 && g_fb.bpp != 24 && g_fb.bpp != 32) {
+    if (g_target->fb.bpp != 16 && g_target->fb.bpp != 24 && g_target->fb.bpp != 32) {
         print("[deimos] render_init: unsupported bpp\n");
         return -1;
     }
 
-    g_bytes_per_pixel = g_fb.bpp / 8;
-    g_pitch = g_fb.pitch ? g_fb.pitch : (g_fb.width * g_bytes_per_pixel);
-    if (g_bytes_per_pixel == 0 || g_pitch == 0) {
+    g_target->bytes_per_pixel = g_target->fb.bpp / 8;
+    g_target->format = render_format_for_bpp((int)g_target->fb.bpp);
+    g_target->pitch = g_target->fb.pitch ? g_target->fb.pitch : (g_target->fb.width * g_target->bytes_per_pixel);
+    if (g_target->bytes_per_pixel == 0 || g_target->pitch == 0) {
         print("[deimos] render_init: bad pitch/bpp\n");
         return -1;
     }
 
-    print("[deimos] render_init: fb_map\n");
-    long addr = fb_map();
-    if (!addr) {
-        print("[deimos] render_init: fb_map failed\n");
-        return -1;
+    uint64_t frame_bytes = (uint64_t)g_target->pitch * g_target->fb.height;
+    g_target->buffer_count = 0;
+    while (frame_bytes <= RENDER_FRAME_POOL_BYTES && g_target->buffer_count < g_requested_buffers) {
+        uint8_t *buffer = render_frame_alloc((uint32_t)frame_bytes);
+        if (!buffer) break;
+        g_target->buffers[g_target->buffer_count++] = buffer;
     }
-    backbuffer = (uint8_t *)addr;
+    if (g_target->buffer_count > 0) {
+        if (g_target->buffer_count < g_requested_buffers) {
+            print("[deimos] render_init: frame pool too small, fewer present buffers\n");
+        }
+        g_target->current = 0;
+        g_target->backbuffer = g_target->buffers[0];
+    } else {
+        print("[deimos] render_init: mode too large for the frame pool, fb_map\n");
+        long addr = fb_map();
+        if (!addr) {
+            print("[deimos] render_init: fb_map failed\n");
+            return -1;
+        }
+        g_target->backbuffer = (uint8_t *)addr;
+        g_target->buffer_count = 1; // drawing is already visible; present stays synchronous
+    }
+    g_target->frame_serial = 0;
+    for (int i = 0; i < RENDER_PRESENT_BUFFERS; i++) {
+        g_target->buffer_serial[i] = 0;
+    }
+
+    alpha_init();
+    print("[deimos] render_init: blend kernel ");
+    print(alpha_kernel_name());
+    print("\n");
 
-    g_dirty_count = 0;
-    g_full_dirty = 1;
+    g_target->dirty_count = 0;
+    g_target->full_dirty = 1;
 
     print("[deimos] render_init: done\n");
     return 0;
 }
 
-int render_width(void)  { return (int)g_fb.width; }
-int render_height(void) { return (int)g_fb.height; }
-int render_bpp(void)    { return (int)g_fb.bpp; }
-int render_pitch(void)  { return (int)g_pitch; }
+int render_width(void)  { return (int)g_target->fb.width; }
+int render_height(void) { return (int)g_target->fb.height; }
+int render_bpp(void)    { return (int)g_target->fb.bpp; }
+int render_pitch(void)  { return (int)g_target->pitch; }
+int render_format(void)  { return g_target->format; }
+uint8_t *render_backbuffer(void) { return g_target->backbuffer; }
 
-void render_begin_frame(uint32_t clear_colour) {
-    if (!backbuffer) return;
+uint32_t render_native_colour(uint32_t colour) {
+    return render_convert_pixel(g_target->format, colour);
+}
+
+static void render_clear_rect(int x, int y, int w, int h, uint32_t clear_colour) {
+    if (!g_target->background) {
+        render_fill_rect_clamped(x, y, w, h, clear_colour);
+        return;
+    }
+
+    struct render_rect r;
+    if (render_clip_rect(x, y, w, h, &r)) {
+        overdraw_count(r.x, r.y, r.w, r.h);
+        copy_rect(g_target->backbuffer, g_target->background, &r);
+    }
+}
+
+// The area the bound output presents for the current damage, clipped to it.
+static int damage_rects(struct render_rect *out) {
+    if (g_target->full_dirty || g_target->dirty_count == 0) {
+        target_bounds(&out[0]);
+        return 1;
+    }
+    int count = 0;
+    for (int i = 0; i < g_target->dirty_count; i++) {
+        const struct render_rect *r = &g_target->dirty_rects[i];
+        if (render_clip_rect(r->x, r->y, r->w, r->h, &out[count])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Debug scratch: one frame's worth (pitched), or one byte per pixel, of the
+// bound output. Sized for the largest output so binding another does not
+// grow it; a later, larger output costs a fresh carve.
+static uint32_t scratch_bytes(const struct render_target *t, int pitched) {
+    return (pitched ? t->pitch : t->fb.width) * t->fb.height;
+}
+
+static uint8_t *scratch_reserve(uint8_t **buffer, uint32_t *capacity, int pitched) {
+    if (*capacity < scratch_bytes(g_target, pitched)) {
+        uint32_t bytes = 0;
+        for (int i = 0; i < g_target_count; i++) {
+            uint32_t need = scratch_bytes(&g_targets[i], pitched);
+            if (need > bytes) bytes = need;
+        }
+        *buffer = render_frame_alloc(bytes);
+        *capacity = *buffer ? bytes : 0;
+    }
+    return *buffer;
+}
+
+static void overdraw_begin(void) {
+    if (!g_overdraw_mode || g_verify.active) return;
+    if (!scratch_reserve(&g_overdraw_counts, &g_overdraw_counts_bytes, 0)) return;
+    if (!scratch_reserve(&g_overdraw_before, &g_overdraw_before_bytes, 1)) return;
+
+    uint32_t pixels = g_target->fb.width * g_target->fb.height;
+    for (uint32_t i = 0; i < pixels; i++) g_overdraw_counts[i] = 0;
 
-    if (g_full_dirty || g_dirty_count == 0) {
-        for (uint32_t y = 0; y < g_fb.height; y++) {
-            for (uint32_t x = 0; x < g_fb.width; x++) {
-                render_store_pixel((int)x, (int)y, clear_colour);
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+    int count = damage_rects(rects);
+    for (int i = 0; i < count; i++) {
+        copy_rect(g_overdraw_before, g_target->backbuffer, &rects[i]);
+    }
+    g_overdraw_counting = 1;
+}
+
+static uint32_t overdraw_heat(int writes) {
+    static const uint32_t heat[6] = {0x000000, 0x2050FF, 0x20C040, 0xF0E020, 0xFF8000, 0xFF0000};
+    return heat[writes < 5 ? writes : 5];
+}
+
+// Blends each pixel of r with the colour of its write count, once.
+static void overdraw_tint(const struct render_rect *r) {
+    int bytes = (int)g_target->bytes_per_pixel;
+    for (int y = r->y; y < r->y + r->h; y++) {
+        uint8_t *count = &g_overdraw_counts[(uint32_t)(y - g_target->origin_y) * g_target->fb.width +
+                                            (uint32_t)(r->x - g_target->origin_x)];
+        uint8_t *p = target_pixel(g_target->backbuffer, r->x, y);
+        for (int i = 0; i < r->w; i++, p += bytes) {
+            int writes = count[i] & OVERDRAW_COUNT_MAX;
+            if (writes == 0 || (count[i] & OVERDRAW_TINTED)) continue;
+            count[i] |= OVERDRAW_TINTED;
+            uint32_t px = render_unpack_pixel(g_target->format, p);
+            px = ((px & 0xFEFEFEU) >> 1) + ((overdraw_heat(writes) & 0xFEFEFEU) >> 1);
+            uint32_t native = render_convert_pixel(g_target->format, px);
+            p[0] = (uint8_t)native;
+            p[1] = (uint8_t)(native >> 8);
+            if (bytes >= 3) p[2] = (uint8_t)(native >> 16);
+            if (bytes == 4) p[3] = (uint8_t)(native >> 24);
+        }
+    }
+}
+
+// Closes the measured frame: accounts the presented area against the pixels
+// that changed, then draws the requested overlay over this frame's own
+// damage and remembers it for cleanup.
+static void overdraw_end(void) {
+    if (!g_overdraw_counting) return;
+    g_overdraw_counting = 0;
+
+    struct render_overdraw_stats *st = &g_target->overdraw_stats;
+    struct render_rect rects[RENDER_MAX_DIRTY_RECTS];
+    int count = damage_rects(rects);
+    int bytes = (int)g_target->bytes_per_pixel;
+    uint64_t presented = 0;
+    uint64_t changed = 0;
+    for (int i = 0; i < count; i++) {
+        const struct render_rect *r = &rects[i];
+        presented += (uint64_t)r->w * (uint64_t)r->h;
+        for (int y = r->y; y < r->y + r->h; y++) {
+            uint32_t offset = (uint32_t)(target_pixel(g_target->backbuffer, r->x, y) - g_target->backbuffer);
+            const uint8_t *now = g_target->backbuffer + offset;
+            const uint8_t *before = g_overdraw_before + offset;
+            uint8_t *flags = &g_overdraw_counts[(uint32_t)(y - g_target->origin_y) * g_target->fb.width +
+                                                (uint32_t)(r->x - g_target->origin_x)];
+            for (int i2 = 0; i2 < r->w; i2++) {
+                if (flags[i2] & OVERDRAW_CHANGED) continue;
+                int differs = 0;
+                for (int k = 0; k < bytes; k++) differs |= now[i2 * bytes + k] != before[i2 * bytes + k];
+                if (!differs) continue;
+                flags[i2] |= OVERDRAW_CHANGED;
+                changed++;
+            }
+        }
+    }
+    st->frames++;
+    st->presented_pixels += presented;
+    st->changed_pixels += changed;
+    st->wasted_bytes += (presented - changed) * (uint64_t)bytes;
+
+    if (g_overdraw_mode < RENDER_OVERDRAW_HEATMAP) return;
+
+    // Only this frame's own damage is overlaid; cleanup of the last overlay is not.
+    g_target->overlay_full = 0;
+    g_target->overlay_count = 0;
+    if (g_target->full_dirty || g_target->dirty_count == 0) {
+        if (g_target->stale_full) return;
+        g_target->overlay_full = 1;
+        target_bounds(&g_target->overlay_rects[0]);
+        g_target->overlay_count = 1;
+    } else {
+        for (int i = g_target->stale_count; i < g_target->dirty_count; i++) {
+            const struct render_rect *r = &g_target->dirty_rects[i];
+            if (render_clip_rect(r->x, r->y, r->w, r->h, &g_target->overlay_rects[g_target->overlay_count])) {
+                g_target->overlay_count++;
             }
         }
+    }
+
+    for (int i = 0; i < g_target->overlay_count; i++) {
+        overdraw_tint(&g_target->overlay_rects[i]);
+    }
+    if (g_overdraw_mode >= RENDER_OVERDRAW_RECTS) {
+        // Outlined after tinting so the edges stay legible.
+        uint32_t edge = render_convert_pixel(g_target->format, 0xFFFFFF);
+        for (int i = 0; i < g_target->overlay_count; i++) {
+            const struct render_rect *r = &g_target->overlay_rects[i];
+            render_fill_native_clamped(r->x, r->y, r->w, 1, edge);
+            render_fill_native_clamped(r->x, r->y + r->h - 1, r->w, 1, edge);
+            render_fill_native_clamped(r->x, r->y, 1, r->h, edge);
+            render_fill_native_clamped(r->x + r->w - 1, r->y, 1, r->h, edge);
+        }
+    }
+}
+
+void render_begin_frame(uint32_t clear_colour) {
+    if (!g_target->backbuffer) return;
+    overdraw_begin();
+
+    if (g_target->full_dirty || g_target->dirty_count == 0) {
+        render_clear_rect(g_target->origin_x, g_target->origin_y, (int)g_target->fb.width, (int)g_target->fb.height,
+                          clear_colour);
         return;
     }
 
-    for (int i = 0; i < g_dirty_count; i++) {
-        struct render_dirty_rect *r = &g_dirty_rects[i];
-        render_fill_rect_clamped(r->x, r->y, r->w, r->h, clear_colour);
+    for (int i = 0; i < g_target->dirty_count; i++) {
+        struct render_rect *r = &g_target->dirty_rects[i];
+        render_clear_rect(r->x, r->y, r->w, r->h, clear_colour);
     }
 }
 
+void render_set_background(const uint8_t *image) {
+    g_target->background = image;
+    g_target->full_dirty = 1;
+    g_target->stale_full = 0;
+    g_background_serial++;
+}
+
+const uint8_t *render_background(void) {
+    return g_target->background;
+}
+
+uint32_t render_background_serial(void) {
+    return g_background_serial;
+}
+
 void render_end_frame(void) {
-    if (!backbuffer) return;
-    fb_present(backbuffer);
+    render_present_full();
 }
 
 void render_putpixel(int x, int y, uint32_t colour) {
-    if (!backbuffer) return;
-    if ((unsigned)x >= g_fb.width || (unsigned)y >= g_fb.height) return;
+    if (!g_target->backbuffer) return;
+    if ((unsigned)(x - g_target->origin_x) >= g_target->fb.width ||
+        (unsigned)(y - g_target->origin_y) >= g_target->fb.height) {
+        return;
+    }
     render_store_pixel(x, y, colour);
 }
 
@@ -208,30 +609,206 @@ void render_clear(uint32_t colour) {
 }
 
 void render_fill_rect(int x, int y, int w, int h, uint32_t colour) {
-    if (!backbuffer) return;
+    if (!g_target->backbuffer) return;
     render_fill_rect_clamped(x, y, w, h, colour);
 }
 
+void render_fill_rect_damaged(int x, int y, int w, int h, uint32_t colour) {
+    if (!g_target->backbuffer) return;
+
+    struct render_rect clips[RENDER_MAX_DIRTY_RECTS];
+    int count = render_damage_clip(x, y, w, h, clips, RENDER_MAX_DIRTY_RECTS);
+    for (int i = 0; i < count; i++) {
+        render_fill_rect_clamped(clips[i].x, clips[i].y, clips[i].w, clips[i].h, colour);
+    }
+}
+
+// Clips the span [x, x + n) of row y to the bound output. Returns how many
+// pixels were cut from its start, or -1 when nothing is left.
+static int clip_span(int *x, int y, int *n) {
+    if ((unsigned)(y - g_target->origin_y) >= g_target->fb.height) return -1;
+
+    int skip = 0;
+    if (*x < g_target->origin_x) {
+        skip = g_target->origin_x - *x;
+        *n -= skip;
+        *x = g_target->origin_x;
+    }
+    int x_end = g_target->origin_x + (int)g_target->fb.width;
+    if (*x + *n > x_end) *n = x_end - *x;
+    return (*n > 0) ? skip : -1;
+}
+
+void render_blend_span(int x, int y, const uint32_t *argb, int n) {
+    if (!g_target->backbuffer || !argb) return;
+    int skip = clip_span(&x, y, &n);
+    if (skip < 0) return;
+    argb += skip;
+    overdraw_count(x, y, n, 1);
+
+    if (g_target->bytes_per_pixel == 4) {
+        uint32_t *row = (uint32_t *)target_pixel(g_target->backbuffer, x, y);
+        alpha_over_span(row, argb, n);
+        return;
+    }
+
+    // 16/24 bpp: unpack to an XRGB staging span, blend, pack back.
+    uint32_t tmp[64];
+    for (int done = 0; done < n; done += 64) {
+        int m = n - done;
+        if (m > 64) m = 64;
+        uint8_t *dst = target_pixel(g_target->backbuffer, x + done, y);
+        render_unpack_span(g_target->format, tmp, dst, m);
+        alpha_over_span(tmp, argb + done, m);
+        render_convert_span(g_target->format, dst, tmp, m, 0, x + done, y);
+    }
+}
+
+void render_fill_rect_native(int x, int y, int w, int h, uint32_t native) {
+    if (!g_target->backbuffer) return;
+    render_fill_native_clamped(x, y, w, h, native);
+}
+
+void render_copy_span_native(int x, int y, const void *src, int n) {
+    if (!g_target->backbuffer || !src) return;
+    int skip = clip_span(&x, y, &n);
+    if (skip < 0) return;
+    overdraw_count(x, y, n, 1);
+
+    const uint8_t *in = (const uint8_t *)src + (uint32_t)skip * g_target->bytes_per_pixel;
+    uint8_t *dst = target_pixel(g_target->backbuffer, x, y);
+    int bytes = n * (int)g_target->bytes_per_pixel;
+    int words = bytes / 8;
+    for (int i = 0; i < words; i++) {
+        ((uint64_t *)dst)[i] = ((const uint64_t *)in)[i];
+    }
+    for (int i = words * 8; i < bytes; i++) {
+        dst[i] = in[i];
+    }
+}
+
+void render_draw_shadow(int x, int y, int w, int h, int radius, int opacity,
+                        int clip_x, int clip_y, int clip_w, int clip_h) {
+    if (!g_target->backbuffer) return;
+    if (opacity <= 0) return;
+    if (opacity > 255) opacity = 255;
+
+    const struct alpha_shadow_profile *p = alpha_shadow_profile(w, h, radius);
+    if (!p) return;
+
+    int bx = x - radius;
+    int by = y - radius;
+    struct render_rect area;
+    if (!render_clip_rect(bx, by, w + 2 * radius, h + 2 * radius, &area)) return;
+    struct render_rect clip;
+    if (!render_clip_rect(clip_x, clip_y, clip_w, clip_h, &clip)) return;
+
+    int x0 = (area.x > clip.x) ? area.x : clip.x;
+    int y0 = (area.y > clip.y) ? area.y : clip.y;
+    int x1 = ((area.x + area.w) < (clip.x + clip.w)) ? (area.x + area.w) : (clip.x + clip.w);
+    int y1 = ((area.y + area.h) < (clip.y + clip.h)) ? (area.y + area.h) : (clip.y + clip.h);
+
+    uint32_t span[64];
+    for (int yy = y0; yy < y1; yy++) {
+        uint32_t row_a = (uint32_t)p->py[yy - by] * (uint32_t)opacity;
+        if (row_a == 0) continue;
+        for (int xx = x0; xx < x1; xx += 64) {
+            int m = x1 - xx;
+            if (m > 64) m = 64;
+            for (int i = 0; i < m; i++) {
+                // Premultiplied black: only the alpha byte is non-zero.
+                uint32_t a = ((uint32_t)p->px[xx + i - bx] * row_a) / (255U * 255U);
+                span[i] = a << 24;
+            }
+            render_blend_span(xx, yy, span, m);
+        }
+    }
+}
+
+// Edges are one UI-scale unit thick.
 void render_draw_rect(int x, int y, int w, int h, uint32_t colour) {
-    for (int xx = 0; xx < w; xx++) {
-        render_putpixel(x + xx, y, colour);
-        render_putpixel(x + xx, y + h - 1, colour);
+    if (!g_target->backbuffer || w <= 0 || h <= 0) return;
+    int t = g_ui_scale;
+    if (t > w / 2 || t > h / 2) {
+        render_fill_rect_clamped(x, y, w, h, colour);
+        return;
     }
-    for (int yy = 0; yy < h; yy++) {
-        render_putpixel(x, y + yy, colour);
-        render_putpixel(x + w - 1, y + yy, colour);
+    uint32_t native = render_convert_pixel(g_target->format, colour);
+    render_fill_native_clamped(x, y, w, t, native);
+    render_fill_native_clamped(x, y + h - t, w, t, native);
+    render_fill_native_clamped(x, y + t, t, h - 2 * t, native);
+    render_fill_native_clamped(x + w - t, y + t, t, h - 2 * t, native);
+}
+
+void render_set_ui_scale(int scale) {
+    if (scale < 1) scale = 1;
+    if (scale > RENDER_MAX_UI_SCALE) scale = RENDER_MAX_UI_SCALE;
+    g_ui_scale = scale;
+}
+
+int render_ui_scale(void) {
+    return g_ui_scale;
+}
+
+// Copies the clipped span [x, x + w) of row y over the next `count` rows.
+static void replicate_row(int x, int y, int w, int count) {
+    struct render_rect r;
+    if (!render_clip_rect(x, y, w, count + 1, &r) || r.y != y) return;
+    overdraw_count(r.x, r.y + 1, r.w, r.h - 1);
+
+    int bytes = r.w * (int)g_target->bytes_per_pixel;
+    int words = bytes / 8;
+    const uint8_t *src = target_pixel(g_target->backbuffer, r.x, y);
+    uint8_t *dst = (uint8_t *)src;
+    for (int row = 1; row < r.h; row++) {
+        dst += g_target->pitch;
+        for (int i = 0; i < words; i++) {
+            ((uint64_t *)dst)[i] = ((const uint64_t *)src)[i];
+        }
+        for (int i = words * 8; i < bytes; i++) {
+            dst[i] = src[i];
+        }
     }
 }
 
+void render_replicate_row(int x, int y, int w, int count) {
+    if (!g_target->backbuffer || count <= 0) return;
+    replicate_row(x, y, w, count);
+}
+
+// Each glyph row's runs of set bits are filled once at the top of their
+// scale x scale cell and copied down, so a scaled glyph costs about as much
+// as filling its lit pixels.
 void render_draw_char(int x, int y, char c, uint32_t colour) {
+    if (!g_target->backbuffer) return;
     const uint8_t *glyph = render_glyph_for_char(c);
+    int s = g_ui_scale;
+    uint32_t native = render_convert_pixel(g_target->format, colour);
 
     for (int row = 0; row < 7; row++) {
         uint8_t bits = glyph[row];
-        for (int col = 0; col < 5; col++) {
-            if ((bits >> (4 - col)) & 1U) {
-                render_putpixel(x + col, y + row, colour);
+        int col = 0;
+        while (col < 5) {
+            if (!((bits >> (4 - col)) & 1U)) {
+                col++;
+                continue;
+            }
+            int start = col;
+            while (col < 5 && ((bits >> (4 - col)) & 1U)) col++;
+
+            int px = x + start * s;
+            int py = y + row * s;
+            int pw = (col - start) * s;
+            if (s == 1) {
+                render_fill_native_clamped(px, py, pw, 1, native);
+                continue;
             }
+            // The top row may be clipped away while rows below are not.
+            int top = py;
+            if (top < g_target->origin_y) top = g_target->origin_y;
+            if (top >= py + s) continue;
+            render_fill_native_clamped(px, top, pw, 1, native);
+            replicate_row(px, top, pw, py + s - 1 - top);
         }
     }
 }
@@ -242,7 +819,7 @@ void render_draw_text(int x, int y, const char *text, uint32_t colour) {
     int pen_x = x;
     for (int i = 0; text[i]; i++) {
         render_draw_char(pen_x, y, text[i], colour);
-        pen_x += 6;
+        pen_x += 6 * g_ui_scale;
     }
 }
 
@@ -252,42 +829,67 @@ int render_text_width(const char *text) {
     int len = 0;
     while (text[len]) len++;
     if (len == 0) return 0;
-    return (len * 6) - 1;
+    return ((len * 6) - 1) * g_ui_scale;
 }
 
-void render_mark_dirty_rect(int x, int y, int w, int h) {
-    if (!backbuffer) return;
-    if (g_full_dirty) return;
+int render_text_height(void) {
+    return 7 * g_ui_scale;
+}
 
-    struct render_dirty_rect r;
+static void target_mark_dirty(int x, int y, int w, int h) {
+    if (!g_target->backbuffer) return;
+
+    struct render_rect r;
     if (!render_clip_rect(x, y, w, h, &r)) {
         return;
     }
+    if (g_target->full_dirty) {
+        // Real damage on top of a full-screen overlay's cleanup: the frame
+        // is the application's again and gets overlaid.
+        g_target->stale_full = 0;
+        return;
+    }
 
-    if (g_dirty_count >= RENDER_MAX_DIRTY_RECTS) {
-        g_full_dirty = 1;
-        g_dirty_count = 0;
+    if (g_target->dirty_count >= RENDER_MAX_DIRTY_RECTS) {
+        g_target->full_dirty = 1;
+        g_target->dirty_count = 0;
+        g_target->stale_full = 0;
         return;
     }
 
-    g_dirty_rects[g_dirty_count++] = r;
+    g_target->dirty_rects[g_target->dirty_count++] = r;
+}
+
+void render_mark_dirty_rect(int x, int y, int w, int h) {
+    struct render_target *bound = g_target;
+    for (int i = 0; i < g_target_count; i++) {
+        g_target = &g_targets[i];
+        target_mark_dirty(x, y, w, h);
+    }
+    g_target = bound;
 }
 
 void render_mark_full_dirty(void) {
-    g_full_dirty = 1;
-    g_dirty_count = 0;
+    for (int i = 0; i < g_target_count; i++) {
+        g_targets[i].full_dirty = 1;
+        g_targets[i].dirty_count = 0;
+        g_targets[i].stale_full = 0;
+    }
 }
 
 int render_has_dirty(void) {
-    return g_full_dirty || (g_dirty_count > 0);
+    return g_target->full_dirty || (g_target->dirty_count > 0);
 }
 
 int render_rect_needs_redraw(int x, int y, int w, int h) {
-    if (g_full_dirty) return 1;
-    if (g_dirty_count <= 0) return 0;
+    if (g_target->full_dirty) {
+        return render_rects_overlap(x, y, w, h, g_target->origin_x, g_target->origin_y,
+                                    (int)g_target->fb.width, (int)g_target->fb.height);
+    }
+    if (g_target->dirty_count <= 0) return 0;
 
-    for (int i = 0; i < g_dirty_count; i++) {
-        struct render_dirty_rect *r = &g_dirty_rects[i];
+    for (int i = 0; i < g_target->dirty_count; i++) {
+        struct render_rect *r = &g_target->dirty_rects[i];
         if (render_rects_overlap(x, y, w, h, r->x, r->y, r->w, r->h)) {
             return 1;
         }
@@ -296,53 +898,535 @@ int render_rect_needs_redraw(int x, int y, int w, int h) {
 }
 
 int render_is_full_dirty(void) {
-    return g_full_dirty;
+    return g_target->full_dirty;
 }
 
 int render_dirty_count(void) {
-    return g_dirty_count;
+    return g_target->dirty_count;
+}
+
+int render_damage_clip(int x, int y, int w, int h, struct render_rect *out, int max_out) {
+    if (!out || max_out <= 0) return 0;
+
+    struct render_rect area;
+    if (!render_clip_rect(x, y, w, h, &area)) {
+        return 0;
+    }
+    if (g_target->full_dirty) {
+        out[0] = area;
+        return 1;
+    }
+
+    int area_x1 = area.x + area.w;
+    int area_y1 = area.y + area.h;
+    int count = 0;
+    for (int i = 0; i < g_target->dirty_count; i++) {
+        const struct render_rect *d = &g_target->dirty_rects[i];
+        int x0 = (d->x > area.x) ? d->x : area.x;
+        int y0 = (d->y > area.y) ? d->y : area.y;
+        int x1 = ((d->x + d->w) < area_x1) ? (d->x + d->w) : area_x1;
+        int y1 = ((d->y + d->h) < area_y1) ? (d->y + d->h) : area_y1;
+        if (x1 <= x0 || y1 <= y0) continue;
+
+        if (count < max_out) {
+            out[count].x = x0;
+            out[count].y = y0;
+            out[count].w = x1 - x0;
+            out[count].h = y1 - y0;
+            count++;
+            continue;
+        }
+
+        struct render_rect *last = &out[max_out - 1];
+        int lx1 = last->x + last->w;
+        int ly1 = last->y + last->h;
+        if (x0 < last->x) last->x = x0;
+        if (y0 < last->y) last->y = y0;
+        if (x1 > lx1) lx1 = x1;
+        if (y1 > ly1) ly1 = y1;
+        last->w = lx1 - last->x;
+        last->h = ly1 - last->y;
+    }
+    return count;
 }
 
-int render_dirty_x(int index) {
-    if (index < 0 || index >= g_dirty_count) return 0;
-    return g_dirty_rects[index].x;
+void render_reset_dirty(void) {
+    g_target->dirty_count = 0;
+    g_target->full_dirty = 0;
+    g_target->stale_count = 0;
+    g_target->stale_full = 0;
+
+    // The overlay just presented is repainted by the next frame.
+    if (g_target->overlay_full) {
+        g_target->full_dirty = 1;
+        g_target->stale_full = 1;
+    } else {
+        for (int i = 0; i < g_target->overlay_count; i++) {
+            const struct render_rect *r = &g_target->overlay_rects[i];
+            target_mark_dirty(r->x, r->y, r->w, r->h);
+        }
+        g_target->stale_count = g_target->dirty_count;
+    }
+    g_target->overlay_count = 0;
+    g_target->overlay_full = 0;
 }
 
-int render_dirty_y(int index) {
-    if (index < 0 || index >= g_dirty_count) return 0;
-    return g_dirty_rects[index].y;
+void render_set_overdraw(int mode) {
+    if (mode < 0) mode = 0;
+    if (mode > RENDER_OVERDRAW_RECTS) mode = RENDER_OVERDRAW_RECTS;
+    g_overdraw_mode = mode;
 }
 
-int render_dirty_w(int index) {
-    if (index < 0 || index >= g_dirty_count) return 0;
-    return g_dirty_rects[index].w;
+void render_overdraw_get_stats(struct render_overdraw_stats *out) {
+    if (!out) return;
+    *out = g_target->overdraw_stats;
 }
 
-int render_dirty_h(int index) {
-    if (index < 0 || index >= g_dirty_count) return 0;
-    return g_dirty_rects[index].h;
+int render_verify_begin(void) {
+    if (!g_target->backbuffer || g_verify.active) return 0;
+    if (!scratch_reserve(&g_verify_buffer, &g_verify_bytes, 1)) return 0;
+
+    g_verify.active = 1;
+    g_verify.incremental = g_target->backbuffer;
+    g_verify.dirty_count = g_target->dirty_count;
+    g_verify.full_dirty = g_target->full_dirty;
+    for (int i = 0; i < g_target->dirty_count; i++) {
+        g_verify.dirty_rects[i] = g_target->dirty_rects[i];
+    }
+
+    g_verify.counting = g_overdraw_counting;
+    g_overdraw_counting = 0;
+    g_target->backbuffer = g_verify_buffer;
+    g_target->dirty_count = 0;
+    g_target->full_dirty = 1;
+    return 1;
 }
 
-void render_reset_dirty(void) {
-    g_dirty_count = 0;
-    g_full_dirty = 0;
+// Rows are compared a word at a time; only rows that differ are walked
+// pixel by pixel.
+uint32_t render_verify_end(struct render_verify_result *out) {
+    if (!g_verify.active) return 0;
+    g_verify.active = 0;
+
+    g_overdraw_counting = g_verify.counting;
+    g_target->backbuffer = g_verify.incremental;
+    g_target->dirty_count = g_verify.dirty_count;
+    g_target->full_dirty = g_verify.full_dirty;
+    for (int i = 0; i < g_verify.dirty_count; i++) {
+        g_target->dirty_rects[i] = g_verify.dirty_rects[i];
+    }
+
+    struct render_verify_result r;
+    r.mismatches = 0;
+    r.x = 0;
+    r.y = 0;
+    r.incremental = 0;
+    r.expected = 0;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    int bytes = (int)g_target->bytes_per_pixel;
+    int row_bytes = (int)g_target->fb.width * bytes;
+    int words = row_bytes / 8;
+    for (int y = 0; y < (int)g_target->fb.height; y++) {
+        const uint8_t *a = g_verify.incremental + (uint32_t)y * g_target->pitch;
+        const uint8_t *b = g_verify_buffer + (uint32_t)y * g_target->pitch;
+        int same = 1;
+        for (int i = 0; i < words && same; i++) {
+            same = ((const uint64_t *)a)[i] == ((const uint64_t *)b)[i];
+        }
+        for (int i = words * 8; i < row_bytes && same; i++) {
+            same = a[i] == b[i];
+        }
+        if (same) continue;
+
+        for (int x = 0; x < (int)g_target->fb.width; x++) {
+            const uint8_t *pa = a + x * bytes;
+            const uint8_t *pb = b + x * bytes;
+            int differs = 0;
+            for (int k = 0; k < bytes; k++) differs |= pa[k] != pb[k];
+            if (!differs) continue;
+
+            if (r.mismatches == 0) {
+                r.x = g_target->origin_x + x;
+                r.y = g_target->origin_y + y;
+                r.incremental = render_unpack_pixel(g_target->format, pa);
+                r.expected = render_unpack_pixel(g_target->format, pb);
+                x0 = x1 = x;
+                y0 = y1 = y;
+            }
+            if (x < x0) x0 = x;
+            if (x > x1) x1 = x;
+            y1 = y;
+            r.mismatches++;
+        }
+    }
+    r.bounds.x = g_target->origin_x + x0;
+    r.bounds.y = g_target->origin_y + y0;
+    r.bounds.w = r.mismatches ? (x1 - x0 + 1) : 0;
+    r.bounds.h = r.mismatches ? (y1 - y0 + 1) : 0;
+    if (out) *out = r;
+    return r.mismatches;
+}
+
+void render_verify_adopt(void) {
+    if (!g_target->backbuffer || !g_verify_buffer || g_verify.active) return;
+    struct render_rect all;
+    target_bounds(&all);
+    copy_rect(g_target->backbuffer, g_verify_buffer, &all);
+    g_target->full_dirty = 1;
+    g_target->dirty_count = 0;
+    g_target->stale_full = 0;
+}
+
+uint8_t *render_frame_alloc(uint32_t bytes) {
+    uint32_t size = (bytes + 63U) & ~63U;
+    if (size < bytes || size > RENDER_FRAME_POOL_BYTES - g_frame_pool_used) return 0;
+    uint8_t *p = &g_frame_pool[g_frame_pool_used];
+    g_frame_pool_used += size;
+    return p;
+}
+
+void render_set_present_buffers(int count) {
+    if (count < 1) count = 1;
+    if (count > RENDER_PRESENT_BUFFERS) count = RENDER_PRESENT_BUFFERS;
+    g_requested_buffers = count;
+}
+
+int render_output_add_virtual(int width, int height, int bpp) {
+    if (g_target_count <= 0 || g_target_count >= RENDER_MAX_OUTPUTS) return -1;
+    if (width <= 0 || height <= 0 || (bpp != 16 && bpp != 24 && bpp != 32)) return -1;
+
+    // A back and a front buffer; the present path copies back to front.
+    uint32_t pitch = (((uint32_t)width * (uint32_t)(bpp / 8)) + 63U) & ~63U;
+    uint64_t bytes = (uint64_t)pitch * (uint32_t)height;
+    uint8_t *pixels = bytes <= RENDER_FRAME_POOL_BYTES / 2U ? render_frame_alloc((uint32_t)(2U * bytes)) : 0;
+    if (!pixels) {
+        print("[deimos] render: virtual output does not fit the frame pool\n");
+        return -1;
+    }
+
+    // New outputs sit to the right of the desktop, top-aligned.
+    int right = render_desktop_width();
+
+    int index = g_target_count;
+    struct render_target *t = &g_targets[index];
+    t->fb.width = (uint32_t)width;
+    t->fb.height = (uint32_t)height;
+    t->fb.bpp = (uint32_t)bpp;
+    t->fb.pitch = pitch;
+    t->origin_x = right;
+    t->origin_y = 0;
+    t->bytes_per_pixel = (uint32_t)(bpp / 8);
+    t->pitch = pitch;
+    t->format = render_format_for_bpp(bpp);
+    t->buffers[0] = pixels;
+    t->front = pixels + bytes;
+    t->buffer_count = 1;
+    t->current = 0;
+    t->backbuffer = t->buffers[0];
+    t->frame_serial = 0;
+    for (int i = 0; i < RENDER_PRESENT_BUFFERS; i++) {
+        t->buffer_serial[i] = 0;
+    }
+    t->dirty_count = 0;
+    t->full_dirty = 1;
+    t->background = 0;
+    g_target_count++;
+    return index;
+}
+
+int render_output_count(void) {
+    return g_target_count;
+}
+
+int render_output_bind(int index) {
+    int previous = (int)(g_target - g_targets);
+    if (index >= 0 && index < g_target_count) {
+        g_target = &g_targets[index];
+    }
+    return previous;
+}
+
+int render_output_current(void) {
+    return (int)(g_target - g_targets);
+}
+
+int render_output_geometry(int index, struct render_rect *out) {
+    if (!out || index < 0 || index >= g_target_count) return 0;
+    out->x = g_targets[index].origin_x;
+    out->y = g_targets[index].origin_y;
+    out->w = (int)g_targets[index].fb.width;
+    out->h = (int)g_targets[index].fb.height;
+    return 1;
+}
+
+int render_output_at(int x, int y) {
+    for (int i = 0; i < g_target_count; i++) {
+        const struct render_target *t = &g_targets[i];
+        if ((unsigned)(x - t->origin_x) < t->fb.width && (unsigned)(y - t->origin_y) < t->fb.height) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void render_output_mark_full_dirty(int index) {
+    if (index < 0 || index >= g_target_count) return;
+    g_targets[index].full_dirty = 1;
+    g_targets[index].dirty_count = 0;
+    g_targets[index].stale_count = 0;
+    g_targets[index].stale_full = 0;
+}
+
+const uint8_t *render_output_front(int index) {
+    if (index < 0 || index >= g_target_count) return 0;
+    return g_targets[index].front;
+}
+
+int render_desktop_width(void) {
+    int right = 0;
+    for (int i = 0; i < g_target_count; i++) {
+        int edge = g_targets[i].origin_x + (int)g_targets[i].fb.width;
+        if (edge > right) right = edge;
+    }
+    return right;
+}
+
+int render_desktop_height(void) {
+    int bottom = 0;
+    for (int i = 0; i < g_target_count; i++) {
+        int edge = g_targets[i].origin_y + (int)g_targets[i].fb.height;
+        if (edge > bottom) bottom = edge;
+    }
+    return bottom;
+}
+
+// Records the damage of a frame the current buffer now holds.
+static void history_push(const struct render_rect *rects, int count) {
+    g_target->frame_serial++;
+    struct damage_frame *frame = &g_target->history[g_target->frame_serial % RENDER_DAMAGE_HISTORY];
+    frame->count = count;
+    for (int i = 0; i < count; i++) {
+        frame->rects[i] = rects[i];
+    }
+    g_target->buffer_serial[g_target->current] = g_target->frame_serial;
+}
+
+// Index of the bound output and pixel totals, for trace records.
+static inline int target_index(void) {
+    return (int)(g_target - g_targets);
+}
+
+static inline uint32_t rects_area(const struct render_rect *rects, int count) {
+    uint32_t area = 0;
+    for (int i = 0; i < count; i++) {
+        area += (uint32_t)(rects[i].w * rects[i].h);
+    }
+    return area;
+}
+
+// Copies into `dst` everything it is missing relative to the backbuffer.
+static void history_repair(int buffer) {
+    uint8_t *dst = g_target->buffers[buffer];
+    uint32_t held = g_target->buffer_serial[buffer];
+    uint32_t age = g_target->frame_serial - held;
+
+    if (held == 0 || age > RENDER_DAMAGE_HISTORY) {
+        struct render_rect all;
+        target_bounds(&all);
+        copy_rect(dst, g_target->backbuffer, &all);
+        g_target->present_stats.full_repairs++;
+        g_target->present_stats.repaired_pixels += (uint32_t)(all.w * all.h);
+        DEIMOS_TRACE4(REPAIR, target_index(), buffer, all.w * all.h, 1);
+        return;
+    }
+
+    uint32_t pixels = 0;
+    for (uint32_t serial = held + 1; serial <= g_target->frame_serial; serial++) {
+        const struct damage_frame *frame = &g_target->history[serial % RENDER_DAMAGE_HISTORY];
+        for (int i = 0; i < frame->count; i++) {
+            copy_rect(dst, g_target->backbuffer, &frame->rects[i]);
+            pixels += (uint32_t)(frame->rects[i].w * frame->rects[i].h);
+        }
+    }
+    g_target->present_stats.repaired_pixels += pixels;
+    DEIMOS_TRACE4(REPAIR, target_index(), buffer, pixels, 0);
+}
+
+// The bound output's present path: the framebuffer syscalls, or a copy into
+// the front buffer of a virtual output.
+static void target_present_rect(const uint8_t *src, int x, int y, int w, int h) {
+    if (g_target->front) {
+        struct render_rect r;
+        r.x = x;
+        r.y = y;
+        r.w = w;
+        r.h = h;
+        copy_rect(g_target->front, src, &r);
+        return;
+    }
+    fb_present_rect(src, x - g_target->origin_x, y - g_target->origin_y, w, h);
+}
+
+static void target_present_all(const uint8_t *src) {
+    if (g_target->front) {
+        struct render_rect all;
+        target_bounds(&all);
+        copy_rect(g_target->front, src, &all);
+        return;
+    }
+    fb_present(src);
+}
+
+// Copies up to `budget` pixels of the oldest job out; returns pixels copied.
+static int present_job_step(int budget) {
+    struct present_job *job = &g_target->jobs[g_target->job_head];
+    const uint8_t *src = g_target->buffers[job->buffer];
+    int done = 0;
+
+    while (job->rect_index < job->count && done < budget) {
+        const struct render_rect *r = &job->rects[job->rect_index];
+        int rows = (budget - done) / r->w;
+        if (rows < 1) rows = 1;
+        if (rows > r->h - job->row) rows = r->h - job->row;
+
+        target_present_rect(src, r->x, r->y + job->row, r->w, rows);
+        done += rows * r->w;
+        job->row += rows;
+        if (job->row >= r->h) {
+            job->rect_index++;
+            job->row = 0;
+        }
+    }
+
+    if (job->rect_index >= job->count) {
+        g_target->job_head = (g_target->job_head + 1) % RENDER_PRESENT_BUFFERS;
+        g_target->job_count--;
+        g_target->present_stats.completed++;
+    }
+    return done;
+}
+
+static int present_buffer_busy(int buffer) {
+    for (int i = 0; i < g_target->job_count; i++) {
+        if (g_target->jobs[(g_target->job_head + i) % RENDER_PRESENT_BUFFERS].buffer == buffer) return 1;
+    }
+    return 0;
+}
+
+// Back-pressure: jobs complete in order, so this blocks until every job up
+// to the last one reading `buffer` is out.
+static void present_drain_buffer(int buffer) {
+    if (!present_buffer_busy(buffer)) return;
+
+    g_target->present_stats.stalls++;
+    DEIMOS_TRACE2(STALL, target_index(), buffer);
+    while (present_buffer_busy(buffer)) {
+        g_target->present_stats.blocking_pixels += (uint32_t)present_job_step(1 << 30);
+    }
+}
+
+static void target_drain(void) {
+    while (g_target->job_count > 0) {
+        g_target->present_stats.blocking_pixels += (uint32_t)present_job_step(1 << 30);
+    }
+}
+
+void render_present_pump(int budget_pixels) {
+    if (render_present_pending() == 0) return;
+    DEIMOS_TRACE1(PUMP_BEGIN, budget_pixels);
+    struct render_target *bound = g_target;
+    int copied = 0;
+    for (int i = 0; i < g_target_count; i++) {
+        g_target = &g_targets[i];
+        while (g_target->job_count > 0 && budget_pixels > 0) {
+            int done = present_job_step(budget_pixels);
+            g_target->present_stats.overlapped_pixels += (uint32_t)done;
+            budget_pixels -= done;
+            copied += done;
+        }
+    }
+    g_target = bound;
+    DEIMOS_TRACE1(PUMP_END, copied);
+}
+
+void render_present_drain(void) {
+    struct render_target *bound = g_target;
+    for (int i = 0; i < g_target_count; i++) {
+        g_target = &g_targets[i];
+        target_drain();
+    }
+    g_target = bound;
+}
+
+int render_present_pending(void) {
+    int pending = 0;
+    for (int i = 0; i < g_target_count; i++) {
+        pending += g_targets[i].job_count;
+    }
+    return pending;
+}
+
+void render_present_get_stats(struct render_present_stats *out) {
+    if (!out) return;
+    *out = g_target->present_stats;
+    out->queue_depth = (uint32_t)g_target->job_count;
 }
 
 void render_present_full(void) {
-    if (!backbuffer) return;
-    fb_present(backbuffer);
+    if (!g_target->backbuffer) return;
+    // Queued slices would paint older frames over this one.
+    target_drain();
+    target_present_all(g_target->backbuffer);
+
+    // Drawn without damage tracking: every other buffer is behind everywhere.
+    struct render_rect all;
+    target_bounds(&all);
+    history_push(&all, 1);
 }
 
 void render_present_dirty(void) {
-    if (!backbuffer) return;
+    if (!g_target->backbuffer) return;
+    overdraw_end();
 
-    if (g_full_dirty || g_dirty_count == 0) {
-        fb_present(backbuffer);
+    if (g_target->buffer_count < 2) {
+        if (g_target->full_dirty || g_target->dirty_count == 0) {
+            target_present_all(g_target->backbuffer);
+            DEIMOS_TRACE4(PRESENT, target_index(), 1, g_target->fb.width * g_target->fb.height, 0);
+            return;
+        }
+        for (int i = 0; i < g_target->dirty_count; i++) {
+            struct render_rect *r = &g_target->dirty_rects[i];
+            target_present_rect(g_target->backbuffer, r->x, r->y, r->w, r->h);
+        }
+        DEIMOS_TRACE4(PRESENT, target_index(), g_target->dirty_count,
+                      rects_area(g_target->dirty_rects, g_target->dirty_count), 0);
         return;
     }
 
-    for (int i = 0; i < g_dirty_count; i++) {
-        struct render_dirty_rect *r = &g_dirty_rects[i];
-        fb_present_rect(backbuffer, r->x, r->y, r->w, r->h);
+    int next = (g_target->current + 1) % g_target->buffer_count;
+    present_drain_buffer(next);
+
+    // Freeze this frame's damage (clipped to the output) into a job.
+    struct present_job *job = &g_target->jobs[(g_target->job_head + g_target->job_count) % RENDER_PRESENT_BUFFERS];
+    job->buffer = g_target->current;
+    job->count = 0;
+    job->rect_index = 0;
+    job->row = 0;
+    job->count = damage_rects(job->rects);
+    if (job->count == 0) return;
+    history_push(job->rects, job->count);
+
+    DEIMOS_TRACE4(PRESENT, target_index(), job->count, rects_area(job->rects, job->count), job->buffer);
+
+    g_target->job_count++;
+    g_target->present_stats.submitted++;
+    if ((uint32_t)g_target->job_count > g_target->present_stats.max_queue_depth) {
+        g_target->present_stats.max_queue_depth = (uint32_t)g_target->job_count;
     }
+
+    // Bring the next buffer up to date for its age and draw there from now on.
+    history_repair(next);
+    g_target->current = next;
+    g_target->backbuffer = g_target->buffers[next];
 }
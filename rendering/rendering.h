@@ -3,37 +3,187 @@
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RENDER_MAX_DIRTY_RECTS 128
+#define RENDER_MAX_OUTPUTS 4
+#define RENDER_MAX_UI_SCALE 3
+
+struct render_rect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+// Opens the framebuffer as output 0 at the desktop origin and binds it.
 int render_init(void);
 
+// Frame-sized buffers (present buffers, virtual outputs, a wallpaper cache,
+// ...) share one static pool, handed out front to back and never freed.
+// Allocate once, after render_init. Returns 64-byte aligned memory, or 0 when
+// the pool is exhausted.
+uint8_t *render_frame_alloc(uint32_t bytes);
+
+// Outputs share one desktop coordinate space, and every drawing and damage
+// query below works on the bound output in desktop coordinates, clipped to
+// it. Marking damage reaches only the outputs the rect overlaps, so damage
+// on one output never makes another redraw.
+//
+// Adds an in-memory framebuffer to the right of the desktop; its present
+// path copies into render_output_front. Returns its index, or -1.
+int render_output_add_virtual(int width, int height, int bpp);
+int render_output_count(void);
+// Binds output `index` for drawing and presenting; returns the previous one.
+int render_output_bind(int index);
+int render_output_current(void);
+// Desktop rect of an output; 0 for a bad index.
+int render_output_geometry(int index, struct render_rect *out);
+// Output containing the desktop point, or -1.
+int render_output_at(int x, int y);
+void render_output_mark_full_dirty(int index);
+// Presented pixels of a virtual output (render_pitch layout while bound);
+// 0 for the framebuffer.
+const uint8_t *render_output_front(int index);
+int render_desktop_width(void);
+int render_desktop_height(void);
+
+// Geometry and format of the bound output.
 int render_width(void);
 int render_height(void);
 int render_bpp(void);
 int render_pitch(void);
+int render_format(void); // RENDER_FORMAT_* of the backbuffer (see convert.h)
+// Converts 0xRRGGBB to the backbuffer's pixel format.
+uint32_t render_native_colour(uint32_t colour);
+// Raw backbuffer of the bound output in its native format (render_pitch
+// bytes/row, starting at the output's desktop origin).
+uint8_t *render_backbuffer(void);
 
+// Clears the damaged area to clear_colour, or from the background image.
 void render_begin_frame(uint32_t clear_colour);
+// Native-format image with render_pitch rows (e.g. a wallpaper cache), or 0.
+void render_set_background(const uint8_t *image);
+// The bound output's background image and a serial that changes whenever any
+// background is set, so copies taken against it can tell it is still current.
+const uint8_t *render_background(void);
+uint32_t render_background_serial(void);
 void render_end_frame(void);
 
 void render_clear(uint32_t colour);
 void render_putpixel(int x, int y, uint32_t colour);
 void render_fill_rect(int x, int y, int w, int h, uint32_t colour);
+void render_fill_rect_damaged(int x, int y, int w, int h, uint32_t colour);
+// Outline whose edges are render_ui_scale pixels thick.
 void render_draw_rect(int x, int y, int w, int h, uint32_t colour);
+// Native-format paths: values/bytes are stored as is, without conversion.
+void render_fill_rect_native(int x, int y, int w, int h, uint32_t native);
+void render_copy_span_native(int x, int y, const void *src, int n);
+// Composites premultiplied 0xAARRGGBB pixels over row y starting at x.
+void render_blend_span(int x, int y, const uint32_t *argb, int n);
+// Blurred drop shadow for the box (x, y, w, h), extending `radius` beyond it,
+// at opacity 0..255, drawn only inside the clip rect.
+void render_draw_shadow(int x, int y, int w, int h, int radius, int opacity,
+                        int clip_x, int clip_y, int clip_w, int clip_h);
+// Copies the span [x, x + w) of row y over the `count` rows below it, e.g.
+// to repeat a row of an upscaled surface instead of resampling it.
+void render_replicate_row(int x, int y, int w, int count);
+
+// Integer HiDPI factor (1..RENDER_MAX_UI_SCALE, default 1). Text, outlines
+// and the decorations and layout margins built on them grow by whole pixels.
+void render_set_ui_scale(int scale);
+int render_ui_scale(void);
+// 5x7 glyphs on a 6-pixel advance, each pixel replicated ui_scale times.
 void render_draw_char(int x, int y, char c, uint32_t colour);
 void render_draw_text(int x, int y, const char *text, uint32_t colour);
 int render_text_width(const char *text);
+int render_text_height(void);
 
+// Both reach every output (see above).
 void render_mark_dirty_rect(int x, int y, int w, int h);
 void render_mark_full_dirty(void);
 int render_has_dirty(void);
 int render_rect_needs_redraw(int x, int y, int w, int h);
 int render_is_full_dirty(void);
 int render_dirty_count(void);
-int render_dirty_x(int index);
-int render_dirty_y(int index);
-int render_dirty_w(int index);
-int render_dirty_h(int index);
+// Writes the damage region intersected with (x, y, w, h) into out and returns
+// the rect count. Full damage yields the screen-clipped rect itself; if more
+// than max_out pieces intersect, the tail is merged into the last entry.
+int render_damage_clip(int x, int y, int w, int h, struct render_rect *out, int max_out);
 void render_reset_dirty(void);
+// Damage verification for the bound output. Between begin and end, drawing
+// goes to a shadow buffer under full damage; end restores the incremental
+// frame and its damage and compares the two, returning the number of
+// differing pixels. begin returns 0 if the output cannot be verified.
+struct render_verify_result {
+    uint32_t mismatches;
+    int x, y;                   // first differing pixel, row-major
+    uint32_t incremental;       // 0xRRGGBB of the incremental frame there
+    uint32_t expected;          // 0xRRGGBB of the full repaint there
+    struct render_rect bounds;  // of all differing pixels
+};
+int render_verify_begin(void);
+uint32_t render_verify_end(struct render_verify_result *out);
+// Replaces the incremental frame with the last full repaint and marks the
+// output fully damaged, so a mismatching frame is never shown.
+void render_verify_adopt(void);
+
+// Overdraw debugging. While a frame is drawn every pixel write is counted
+// (clears, window content, decorations, overlays); render_present_dirty then
+// accounts the presented area. In HEATMAP mode the frame's damage is tinted
+// by write count (1 blue, 2 green, 3 yellow, 4 orange, 5+ red) and RECTS also
+// outlines the presented rects; the overlay is repainted by the next frame.
+#define RENDER_OVERDRAW_OFF 0
+#define RENDER_OVERDRAW_STATS 1
+#define RENDER_OVERDRAW_HEATMAP 2
+#define RENDER_OVERDRAW_RECTS 3
+
+struct render_overdraw_stats {
+    uint32_t frames;
+    uint64_t writes;           // pixel writes while drawing
+    uint64_t presented_pixels; // area handed to the present path, overlaps counted twice
+    uint64_t changed_pixels;   // presented pixels whose value actually changed
+    uint64_t wasted_bytes;     // presented without changing
+};
+
+void render_set_overdraw(int mode);
+// Totals of the bound output.
+void render_overdraw_get_stats(struct render_overdraw_stats *out);
+
+// Synchronous: drains queued presents first.
 void render_present_full(void);
+// Queues the damaged area of this frame for copy-out and continues drawing in
+// the next system-memory buffer (synchronous with a single buffer).
 void render_present_dirty(void);
+// System-memory buffers to rotate through (1..3, default 2); call before
+// render_init. Each extra buffer lets one more frame be in flight.
+void render_set_present_buffers(int count);
 
+// Present pipeline metrics. Overlapped pixels were copied out by pumps between
+// frames; blocking ones by drains when drawing had to wait for a buffer.
+struct render_present_stats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t stalls;
+    uint32_t queue_depth;
+    uint32_t max_queue_depth;
+    uint32_t overlapped_pixels;
+    uint32_t blocking_pixels;
+    uint32_t repaired_pixels; // copied forward into a reused buffer, by age
+    uint32_t full_repairs;    // reuses older than the damage history
+};
+
+// Copies up to budget_pixels of queued frames out, across all outputs.
+void render_present_pump(int budget_pixels);
+void render_present_drain(void);
+int render_present_pending(void);
+// Stats of the bound output.
+void render_present_get_stats(struct render_present_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,295 @@
+#include "wallpaper.h"
+#include "convert.h"
+#include "rendering.h"
+#include "util.h"
+#include <libsys.h>
+
+#define WALLPAPER_READ_CHUNK 4096
+
+// Screen-sized, from the frame pool once an image opens; when the pool is
+// full the flat background colour stays.
+static uint8_t *g_cache;
+static uint32_t g_cache_bytes;
+static uint32_t g_src_row[WALLPAPER_MAX_WIDTH];
+static uint32_t g_dst_row[WALLPAPER_MAX_WIDTH];
+
+struct wallpaper_stream {
+    int fd;
+    int pos;
+    int len;
+    uint8_t buf[WALLPAPER_READ_CHUNK];
+};
+
+static struct wallpaper_stream g_stream;
+
+// Receives decoded source rows in order and writes the screen rows they map to.
+struct wallpaper_target {
+    int mode;
+    int dither;
+    int format;
+    int pitch;
+    int screen_w;
+    int screen_h;
+    int src_w;
+    int src_h;
+};
+
+static int next_byte(struct wallpaper_stream *s) {
+    if (s->pos >= s->len) {
+        s->len = read(s->fd, s->buf, WALLPAPER_READ_CHUNK);
+        s->pos = 0;
+        if (s->len <= 0) {
+            s->len = 0;
+            return -1;
+        }
+    }
+    return s->buf[s->pos++];
+}
+
+static void convert_row(const struct wallpaper_target *t, int dy) {
+    render_convert_span(t->format, g_cache + (uint32_t)dy * (uint32_t)t->pitch, g_dst_row,
+                        t->screen_w, t->dither, 0, dy);
+}
+
+static void emit_row(const struct wallpaper_target *t, int sy) {
+    if (t->mode == WALLPAPER_MODE_TILE) {
+        if (sy >= t->screen_h) return;
+        for (int dx = 0, sx = 0; dx < t->screen_w; dx++) {
+            g_dst_row[dx] = g_src_row[sx];
+            if (++sx == t->src_w) sx = 0;
+        }
+        convert_row(t, sy);
+        return;
+    }
+
+    // Screen rows dy that sample this row: floor(dy * src_h / screen_h) == sy.
+    int dy0 = (sy * t->screen_h + t->src_h - 1) / t->src_h;
+    int dy1 = ((sy + 1) * t->screen_h + t->src_h - 1) / t->src_h;
+    if (dy1 <= dy0) return;
+
+    for (int dx = 0; dx < t->screen_w; dx++) {
+        g_dst_row[dx] = g_src_row[(dx * t->src_w) / t->screen_w];
+    }
+    for (int dy = dy0; dy < dy1 && dy < t->screen_h; dy++) {
+        convert_row(t, dy);
+    }
+}
+
+// Tiling only decodes the first src_h screen rows; the rest repeat them.
+static void finish_tiles(const struct wallpaper_target *t) {
+    if (t->mode != WALLPAPER_MODE_TILE) return;
+
+    int row_bytes = t->screen_w * render_format_bytes(t->format);
+    for (int dy = t->src_h; dy < t->screen_h; dy++) {
+        uint8_t *dst = g_cache + (uint32_t)dy * (uint32_t)t->pitch;
+        const uint8_t *src = g_cache + (uint32_t)(dy - t->src_h) * (uint32_t)t->pitch;
+        for (int i = 0; i < row_bytes; i++) dst[i] = src[i];
+    }
+}
+
+static int read_ppm_number(struct wallpaper_stream *s, int *out) {
+    int c = next_byte(s);
+    for (;;) {
+        if (c == '#') {
+            while (c >= 0 && c != '\n') c = next_byte(s);
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            c = next_byte(s);
+        } else {
+            break;
+        }
+    }
+    if (c < '0' || c > '9') return 0;
+
+    int v = 0;
+    while (c >= '0' && c <= '9') {
+        if (v > 100000) return 0;
+        v = v * 10 + (c - '0');
+        c = next_byte(s);
+    }
+    // The single whitespace byte after the header's maxval is consumed here.
+    *out = v;
+    return 1;
+}
+
+// Binary PPM after the "P6" magic.
+static int decode_ppm(struct wallpaper_stream *s, struct wallpaper_target *t) {
+    int w, h, maxval;
+    if (!read_ppm_number(s, &w) || !read_ppm_number(s, &h) || !read_ppm_number(s, &maxval)) return 0;
+    if (w <= 0 || h <= 0 || w > WALLPAPER_MAX_WIDTH || h > WALLPAPER_MAX_HEIGHT) return 0;
+    if (maxval <= 0 || maxval > 255) return 0;
+    if ((uint64_t)w * (uint64_t)h * 3U > 0xFFFFFFFFULL) return 0;
+    t->src_w = w;
+    t->src_h = h;
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int r = next_byte(s);
+            int g = next_byte(s);
+            int b = next_byte(s);
+            if (b < 0) return 0;
+            if (maxval != 255) {
+                r = (r * 255) / maxval;
+                g = (g * 255) / maxval;
+                b = (b * 255) / maxval;
+            }
+            g_src_row[x] = ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+        }
+        emit_row(t, y);
+    }
+    return 1;
+}
+
+static int read_be32(struct wallpaper_stream *s, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = next_byte(s);
+        if (c < 0) return 0;
+        v = (v << 8) | (uint32_t)c;
+    }
+    *out = v;
+    return 1;
+}
+
+// QOI after the "qoif" magic. Alpha is decoded (it feeds the index hash) but
+// dropped: the background is opaque.
+static int decode_qoi(struct wallpaper_stream *s, struct wallpaper_target *t) {
+    uint32_t w, h;
+    if (!read_be32(s, &w) || !read_be32(s, &h)) return 0;
+    int channels = next_byte(s);
+    int colorspace = next_byte(s);
+    if (colorspace < 0 || (channels != 3 && channels != 4)) return 0;
+    if (w == 0 || h == 0 || w > WALLPAPER_MAX_WIDTH || h > WALLPAPER_MAX_HEIGHT) return 0;
+    t->src_w = (int)w;
+    t->src_h = (int)h;
+
+    uint32_t index[64];
+    for (int i = 0; i < 64; i++) index[i] = 0;
+    uint32_t r = 0, g = 0, b = 0, a = 255;
+    int run = 0;
+
+    for (int y = 0; y < (int)h; y++) {
+        for (int x = 0; x < (int)w; x++) {
+            if (run > 0) {
+                run--;
+            } else {
+                int op = next_byte(s);
+                if (op < 0) return 0;
+                if (op == 0xFE || op == 0xFF) {
+                    int cr = next_byte(s);
+                    int cg = next_byte(s);
+                    int cb = next_byte(s);
+                    if (cb < 0) return 0;
+                    r = (uint32_t)cr;
+                    g = (uint32_t)cg;
+                    b = (uint32_t)cb;
+                    if (op == 0xFF) {
+                        int ca = next_byte(s);
+                        if (ca < 0) return 0;
+                        a = (uint32_t)ca;
+                    }
+                } else if ((op & 0xC0) == 0x00) {
+                    uint32_t p = index[op];
+                    r = (p >> 16) & 0xFF;
+                    g = (p >> 8) & 0xFF;
+                    b = p & 0xFF;
+                    a = p >> 24;
+                } else if ((op & 0xC0) == 0x40) {
+                    r = (r + (uint32_t)((op >> 4) & 3) - 2) & 0xFF;
+                    g = (g + (uint32_t)((op >> 2) & 3) - 2) & 0xFF;
+                    b = (b + (uint32_t)(op & 3) - 2) & 0xFF;
+                } else if ((op & 0xC0) == 0x80) {
+                    int next = next_byte(s);
+                    if (next < 0) return 0;
+                    int dg = (op & 0x3F) - 32;
+                    r = (r + (uint32_t)(dg - 8 + ((next >> 4) & 0x0F))) & 0xFF;
+                    g = (g + (uint32_t)dg) & 0xFF;
+                    b = (b + (uint32_t)(dg - 8 + (next & 0x0F))) & 0xFF;
+                } else {
+                    run = op & 0x3F; // this pixel plus `run` more
+                }
+                index[(r * 3 + g * 5 + b * 7 + a * 11) % 64] = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+            g_src_row[x] = (r << 16) | (g << 8) | b;
+        }
+        emit_row(t, y);
+    }
+    return 1;
+}
+
+int wallpaper_load(const char *path, int mode, int dither) {
+    if (!path || !path[0]) return -1;
+
+    uint64_t start = ticks();
+    struct wallpaper_target t;
+    t.mode = (mode == WALLPAPER_MODE_TILE) ? WALLPAPER_MODE_TILE : WALLPAPER_MODE_STRETCH;
+    t.dither = dither;
+    t.format = render_format();
+    t.pitch = render_pitch();
+    t.screen_w = render_width();
+    t.screen_h = render_height();
+    t.src_w = 0;
+    t.src_h = 0;
+
+    uint32_t bytes = (uint32_t)t.pitch * (uint32_t)t.screen_h;
+    if (t.screen_w <= 0 || t.screen_w > WALLPAPER_MAX_WIDTH) {
+        print("[deimos] wallpaper: mode too wide\n");
+        return -1;
+    }
+
+    struct wallpaper_stream *s = &g_stream;
+    s->fd = open(path, O_RDONLY);
+    if (s->fd < 0) {
+        print("[deimos] wallpaper: cannot open ");
+        print(path);
+        print("\n");
+        return -1;
+    }
+    s->pos = 0;
+    s->len = 0;
+
+    if (g_cache_bytes < bytes) {
+        g_cache = render_frame_alloc(bytes);
+        g_cache_bytes = g_cache ? bytes : 0;
+    }
+    if (!g_cache) {
+        print("[deimos] wallpaper: frame pool full, no cache\n");
+        close(s->fd);
+        return -1;
+    }
+    // Rows are decoded straight into the cache, so a reload must not leave a
+    // half-written image bound if it fails part way.
+    if (render_background() == g_cache) render_set_background(0);
+
+    int m0 = next_byte(s);
+    int m1 = next_byte(s);
+    int ok = 0;
+    if (m0 == 'P' && m1 == '6') {
+        ok = decode_ppm(s, &t);
+    } else if (m0 == 'q' && m1 == 'o' && next_byte(s) == 'i' && next_byte(s) == 'f') {
+        ok = decode_qoi(s, &t);
+    }
+    close(s->fd);
+
+    if (!ok) {
+        print("[deimos] wallpaper: unsupported or truncated image\n");
+        return -1;
+    }
+    finish_tiles(&t);
+    render_set_background(g_cache);
+
+    uint32_t ms = (uint32_t)((ticks() - start) * 10U);
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] wallpaper ");
+    n = deimos_append_u32(line, n, (uint32_t)t.src_w);
+    n = deimos_append_str(line, n, "x");
+    n = deimos_append_u32(line, n, (uint32_t)t.src_h);
+    n = deimos_append_str(line, n, t.mode == WALLPAPER_MODE_TILE ? " tiled in " : " scaled in ");
+    n = deimos_append_u32(line, n, ms);
+    n = deimos_append_str(line, n, "ms, cache ");
+    n = deimos_append_u32(line, n, bytes / 1024U);
+    n = deimos_append_str(line, n, " KiB\n");
+    line[n] = '\0';
+    print(line);
+    return 0;
+}
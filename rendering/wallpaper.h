@@ -0,0 +1,30 @@
+#ifndef RENDERING_WALLPAPER_H
+#define RENDERING_WALLPAPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLPAPER_MODE_STRETCH 0
+#define WALLPAPER_MODE_TILE 1
+
+// Source images wider than this are rejected (one row is buffered in XRGB).
+#define WALLPAPER_MAX_WIDTH 4096
+// Taller ones too, which keeps the row mapping (src_h * screen_h) in int.
+#define WALLPAPER_MAX_HEIGHT 65536
+
+// Decodes a binary PPM (P6) or QOI image row by row as it is read, scales
+// (nearest) or tiles it to the screen and stores the result in the
+// framebuffer's format. On success the image becomes the render background:
+// cleared areas are copied from it instead of filled. Logs load time and
+// cache size. Returns 0 on success, -1 on failure: the flat colour is used,
+// since a wallpaper loaded earlier is unbound before its cache is rewritten.
+int wallpaper_load(const char *path, int mode, int dither);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,206 @@
+// Host-side decoder for deimos capture streams (see rendering/capture.h).
+// Rebuilds every frame, checks each rect's checksum and optionally writes
+// frames as binary PPM.
+//
+//   dcap_decode <capture> [-o <prefix>] [-every <n>]
+//
+// With -o, keyframes and every n-th frame (default: keyframes only) are
+// written to <prefix>_<index>.ppm.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rendering/capture.h"
+
+struct reader {
+    FILE *f;
+    uint64_t offset;
+    int eof;
+};
+
+static uint32_t get_u8(struct reader *r) {
+    int c = fgetc(r->f);
+    if (c == EOF) {
+        r->eof = 1;
+        return 0;
+    }
+    r->offset++;
+    return (uint32_t)c;
+}
+
+static uint32_t get_u16(struct reader *r) {
+    uint32_t lo = get_u8(r);
+    return lo | (get_u8(r) << 8);
+}
+
+static uint32_t get_u32(struct reader *r) {
+    uint32_t lo = get_u16(r);
+    return lo | (get_u16(r) << 16);
+}
+
+static int get_magic(struct reader *r, const char *magic) {
+    char m[4];
+    for (int i = 0; i < 4; i++) m[i] = (char)get_u8(r);
+    return !r->eof && memcmp(m, magic, 4) == 0;
+}
+
+static uint32_t fnv_word(uint32_t h, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        h ^= (v >> (i * 8)) & 0xFF;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+// Decodes one rect into the frame; returns 1 if its checksum matches.
+static int decode_rect(struct reader *r, uint32_t *frame, uint32_t width, uint32_t height) {
+    uint32_t x0 = get_u16(r);
+    uint32_t y0 = get_u16(r);
+    uint32_t w = get_u16(r);
+    uint32_t h = get_u16(r);
+    if (r->eof || x0 + w > width || y0 + h > height) return 0;
+
+    uint32_t index[64] = {0};
+    uint32_t px = 0;
+    uint32_t hash = 2166136261U;
+    int run = 0;
+
+    for (uint32_t y = y0; y < y0 + h; y++) {
+        for (uint32_t x = x0; x < x0 + w; x++) {
+            if (run > 0) {
+                run--;
+            } else {
+                uint32_t op = get_u8(r);
+                uint32_t pr = (px >> 16) & 0xFF;
+                uint32_t pg = (px >> 8) & 0xFF;
+                uint32_t pb = px & 0xFF;
+                if (op == 0xFE) {
+                    pr = get_u8(r);
+                    pg = get_u8(r);
+                    pb = get_u8(r);
+                } else if ((op & 0xC0) == 0x00) {
+                    uint32_t v = index[op];
+                    pr = (v >> 16) & 0xFF;
+                    pg = (v >> 8) & 0xFF;
+                    pb = v & 0xFF;
+                } else if ((op & 0xC0) == 0x40) {
+                    pr = (pr + ((op >> 4) & 3) - 2) & 0xFF;
+                    pg = (pg + ((op >> 2) & 3) - 2) & 0xFF;
+                    pb = (pb + (op & 3) - 2) & 0xFF;
+                } else if ((op & 0xC0) == 0x80) {
+                    uint32_t next = get_u8(r);
+                    int dg = (int)(op & 0x3F) - 32;
+                    pr = (uint32_t)((int)pr + dg - 8 + (int)((next >> 4) & 0x0F)) & 0xFF;
+                    pg = (uint32_t)((int)pg + dg) & 0xFF;
+                    pb = (uint32_t)((int)pb + dg - 8 + (int)(next & 0x0F)) & 0xFF;
+                } else {
+                    run = (int)(op & 0x3F);
+                }
+                if (r->eof) return 0;
+                px = (pr << 16) | (pg << 8) | pb;
+                index[(pr * 3 + pg * 5 + pb * 7 + 255 * 11) % 64] = px;
+            }
+            frame[y * width + x] = px;
+            hash = fnv_word(hash, px);
+        }
+    }
+    return get_u32(r) == hash && !r->eof;
+}
+
+static int write_ppm(const char *prefix, uint32_t index, const uint32_t *frame, uint32_t w, uint32_t h) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%06u.ppm", prefix, index);
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+    fprintf(f, "P6\n%u %u\n255\n", w, h);
+    for (uint32_t i = 0; i < w * h; i++) {
+        uint8_t rgb[3] = {(uint8_t)(frame[i] >> 16), (uint8_t)(frame[i] >> 8), (uint8_t)frame[i]};
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *path = 0;
+    const char *prefix = 0;
+    uint32_t every = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "-every") == 0 && i + 1 < argc) {
+            every = (uint32_t)strtoul(argv[++i], 0, 10);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <capture> [-o <prefix>] [-every <n>]\n", argv[0]);
+        return 2;
+    }
+
+    struct reader r = {0};
+    r.f = fopen(path, "rb");
+    if (!r.f) {
+        perror(path);
+        return 1;
+    }
+    if (!get_magic(&r, CAPTURE_MAGIC) || get_u32(&r) != CAPTURE_VERSION) {
+        fprintf(stderr, "%s: not a version %d capture\n", path, CAPTURE_VERSION);
+        return 1;
+    }
+    uint32_t width = get_u32(&r);
+    uint32_t height = get_u32(&r);
+    if (r.eof || width == 0 || height == 0 || width > CAPTURE_MAX_WIDTH || height > 65535) {
+        fprintf(stderr, "%s: bad header\n", path);
+        return 1;
+    }
+
+    uint32_t *frame = calloc((size_t)width * height, sizeof(uint32_t));
+    if (!frame) return 1;
+
+    uint32_t frames = 0, keyframes = 0, bad_rects = 0, rects_total = 0;
+    int have_key = 0;
+    while (!r.eof) {
+        uint64_t start = r.offset;
+        if (!get_magic(&r, CAPTURE_FRAME_MAGIC)) {
+            if (!r.eof) fprintf(stderr, "frame %u: lost sync at byte %llu\n", frames, (unsigned long long)start);
+            break;
+        }
+        uint32_t index = get_u32(&r);
+        uint32_t tick = get_u32(&r);
+        uint32_t flags = get_u16(&r);
+        uint32_t count = get_u16(&r);
+        if (flags & CAPTURE_FLAG_KEYFRAME) {
+            have_key = 1;
+            keyframes++;
+        }
+
+        uint32_t bad = 0;
+        for (uint32_t i = 0; i < count && !r.eof; i++) {
+            if (!decode_rect(&r, frame, width, height)) bad++;
+        }
+        if (r.eof) {
+            fprintf(stderr, "frame %u: truncated\n", index);
+            break;
+        }
+        frames++;
+        rects_total += count;
+        bad_rects += bad;
+        printf("frame %6u t=%7u %s rects=%3u bytes=%8llu%s\n", index, tick,
+               (flags & CAPTURE_FLAG_KEYFRAME) ? "key" : "   ", count,
+               (unsigned long long)(r.offset - start), bad ? " CHECKSUM MISMATCH" : "");
+
+        int wanted = (flags & CAPTURE_FLAG_KEYFRAME) || (every > 0 && index % every == 0);
+        if (prefix && have_key && wanted && !write_ppm(prefix, index, frame, width, height)) {
+            fprintf(stderr, "cannot write frame %u\n", index);
+        }
+    }
+
+    printf("%ux%u: %u frames (%u key), %u rects, %u bad, %.1f bytes/frame\n", width, height, frames,
+           keyframes, rects_total, bad_rects, frames ? (double)r.offset / frames : 0.0);
+    free(frame);
+    fclose(r.f);
+    return bad_rects ? 1 : 0;
+}
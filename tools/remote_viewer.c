@@ -0,0 +1,263 @@
+// Reference viewer for the deimos remote display (see
+// compositor/remote_protocol.h). Applies every frame to a local copy of the
+// screen, acknowledges it, and optionally sends scripted input back.
+//
+//   remote_viewer <stream | unix:<socket>> [-events <path>] [-o <out.ppm>]
+//                 [-script <file>]
+//
+// A unix: socket carries both directions; otherwise acks and input go to
+// -events (e.g. a fifo the compositor reads as remote_in). The screen is
+// written as binary PPM after every frame when -o is given. Script lines are
+// "move x y", "down x y", "up x y" (left button) and "key <code> <0|1>",
+// and are sent after the first frame.
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "compositor/remote_protocol.h"
+#include "rendering/convert.h"
+
+struct reader {
+    FILE *f;
+    int eof;
+};
+
+static uint32_t get_u8(struct reader *r) {
+    int c = fgetc(r->f);
+    if (c == EOF) {
+        r->eof = 1;
+        return 0;
+    }
+    return (uint32_t)c;
+}
+
+static uint32_t get_u16(struct reader *r) {
+    uint32_t lo = get_u8(r);
+    return lo | (get_u8(r) << 8);
+}
+
+static uint32_t get_u32(struct reader *r) {
+    uint32_t lo = get_u16(r);
+    return lo | (get_u16(r) << 16);
+}
+
+static int send_bytes(int fd, const uint8_t *b, int n) {
+    if (fd < 0) return 0;
+    return write(fd, b, (size_t)n) == n;
+}
+
+static void send_ack(int fd, uint32_t serial) {
+    uint8_t m[5] = {DEIMOS_REMOTE_ACK, (uint8_t)serial, (uint8_t)(serial >> 8), (uint8_t)(serial >> 16),
+                    (uint8_t)(serial >> 24)};
+    send_bytes(fd, m, 5);
+}
+
+static void send_pointer(int fd, int x, int y, int buttons) {
+    uint8_t m[7] = {DEIMOS_REMOTE_POINTER, (uint8_t)x, (uint8_t)(x >> 8), (uint8_t)y, (uint8_t)(y >> 8),
+                    (uint8_t)buttons, 0};
+    send_bytes(fd, m, 7);
+}
+
+static void send_key(int fd, int key, int pressed) {
+    uint8_t m[6] = {DEIMOS_REMOTE_KEY, (uint8_t)key, (uint8_t)(pressed ? 1 : 0), 0, 0, 0};
+    send_bytes(fd, m, 6);
+}
+
+static void send_script(int fd, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        int a = 0, b = 0;
+        if (sscanf(line, "move %d %d", &a, &b) == 2) {
+            send_pointer(fd, a, b, 0);
+        } else if (sscanf(line, "down %d %d", &a, &b) == 2) {
+            send_pointer(fd, a, b, 1);
+        } else if (sscanf(line, "up %d %d", &a, &b) == 2) {
+            send_pointer(fd, a, b, 0);
+        } else if (sscanf(line, "key %d %d", &a, &b) == 2) {
+            send_key(fd, a, b);
+        }
+    }
+    fclose(f);
+}
+
+static int connect_unix(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Same expansion as render_unpack_pixel, for the PPM dump.
+static uint32_t unpack(int format, const uint8_t *p) {
+    if (format == RENDER_FORMAT_RGB565) {
+        uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+        uint32_t r = (v >> 11) & 0x1F;
+        uint32_t g = (v >> 5) & 0x3F;
+        uint32_t b = v & 0x1F;
+        return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+    }
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+static int write_ppm(const char *path, const uint8_t *screen, uint32_t w, uint32_t h, int format, int bytes) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+    fprintf(f, "P6\n%u %u\n255\n", w, h);
+    for (uint32_t i = 0; i < w * h; i++) {
+        uint32_t px = unpack(format, screen + (size_t)i * bytes);
+        uint8_t rgb[3] = {(uint8_t)(px >> 16), (uint8_t)(px >> 8), (uint8_t)px};
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+    return 1;
+}
+
+static int rect_ok(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t width, uint32_t height) {
+    return x + w <= width && y + h <= height;
+}
+
+int main(int argc, char **argv) {
+    const char *stream = 0;
+    const char *events = 0;
+    const char *out = 0;
+    const char *script = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-events") == 0 && i + 1 < argc) {
+            events = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "-script") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else {
+            stream = argv[i];
+        }
+    }
+    if (!stream) {
+        fprintf(stderr, "usage: %s <stream | unix:<socket>> [-events <path>] [-o <out.ppm>] [-script <file>]\n",
+                argv[0]);
+        return 2;
+    }
+
+    struct reader r = {0};
+    int back = -1;
+    if (strncmp(stream, "unix:", 5) == 0) {
+        back = connect_unix(stream + 5);
+        if (back < 0) {
+            perror(stream + 5);
+            return 1;
+        }
+        r.f = fdopen(back, "rb");
+    } else {
+        r.f = fopen(stream, "rb");
+        if (events) back = open(events, O_WRONLY);
+    }
+    if (!r.f) {
+        perror(stream);
+        return 1;
+    }
+
+    char magic[4];
+    for (int i = 0; i < 4; i++) magic[i] = (char)get_u8(&r);
+    if (r.eof || memcmp(magic, DEIMOS_REMOTE_MAGIC, 4) != 0 || get_u32(&r) != DEIMOS_REMOTE_VERSION) {
+        fprintf(stderr, "%s: not a version %d remote stream\n", stream, DEIMOS_REMOTE_VERSION);
+        return 1;
+    }
+    uint32_t width = get_u16(&r);
+    uint32_t height = get_u16(&r);
+    int format = (int)get_u8(&r);
+    int bytes = (int)get_u8(&r);
+    int expected = format == RENDER_FORMAT_RGB565 ? 2 : (format == RENDER_FORMAT_RGB888 ? 3 : 4);
+    if (r.eof || width == 0 || height == 0 || bytes != expected) {
+        fprintf(stderr, "%s: bad hello\n", stream);
+        return 1;
+    }
+    size_t pitch = (size_t)width * bytes;
+    uint8_t *screen = calloc(pitch, height);
+    if (!screen) return 1;
+
+    uint32_t frames = 0;
+    uint64_t copies = 0, raws = 0, rles = 0;
+    int script_sent = 0;
+    while (!r.eof) {
+        uint32_t type = get_u8(&r);
+        if (r.eof) break;
+        if (type == DEIMOS_REMOTE_FRAME_BEGIN) {
+            get_u32(&r);
+        } else if (type == DEIMOS_REMOTE_COPY) {
+            uint32_t sx = get_u16(&r), sy = get_u16(&r), w = get_u16(&r), h = get_u16(&r);
+            uint32_t dx = get_u16(&r), dy = get_u16(&r);
+            if (!rect_ok(sx, sy, w, h, width, height) || !rect_ok(dx, dy, w, h, width, height)) break;
+            // Row order chosen so an overlapping move never reads a row it wrote.
+            for (uint32_t i = 0; i < h; i++) {
+                uint32_t k = dy > sy ? h - 1 - i : i;
+                memmove(screen + (dy + k) * pitch + dx * bytes, screen + (sy + k) * pitch + sx * bytes,
+                        (size_t)w * bytes);
+            }
+            copies++;
+        } else if (type == DEIMOS_REMOTE_RAW || type == DEIMOS_REMOTE_RLE) {
+            uint32_t x = get_u16(&r), y = get_u16(&r), w = get_u16(&r), h = get_u16(&r);
+            if (!rect_ok(x, y, w, h, width, height)) break;
+            for (uint32_t row = 0; row < h && !r.eof; row++) {
+                uint8_t *dst = screen + (y + row) * pitch + x * bytes;
+                if (type == DEIMOS_REMOTE_RAW) {
+                    if (fread(dst, (size_t)bytes, w, r.f) != w) r.eof = 1;
+                    continue;
+                }
+                uint32_t filled = 0;
+                while (filled < w && !r.eof) {
+                    uint32_t run = get_u16(&r);
+                    uint8_t px[4];
+                    for (int b = 0; b < bytes; b++) px[b] = (uint8_t)get_u8(&r);
+                    if (run == 0 || filled + run > w) {
+                        r.eof = 1;
+                        break;
+                    }
+                    for (uint32_t k = 0; k < run; k++) memcpy(dst + (filled + k) * bytes, px, (size_t)bytes);
+                    filled += run;
+                }
+            }
+            if (type == DEIMOS_REMOTE_RAW) {
+                raws++;
+            } else {
+                rles++;
+            }
+        } else if (type == DEIMOS_REMOTE_FRAME_END) {
+            uint32_t serial = get_u32(&r);
+            if (r.eof) break;
+            frames++;
+            if (out && !write_ppm(out, screen, width, height, format, bytes)) {
+                fprintf(stderr, "cannot write %s\n", out);
+            }
+            send_ack(back, serial);
+            if (script && !script_sent) {
+                send_script(back, script);
+                script_sent = 1;
+            }
+        } else {
+            fprintf(stderr, "unknown message %u, stopping\n", type);
+            break;
+        }
+    }
+
+    printf("%ux%u format %d: %u frames, %llu copies, %llu raw, %llu rle\n", width, height, format, frames,
+           (unsigned long long)copies, (unsigned long long)raws, (unsigned long long)rles);
+    free(screen);
+    return 0;
+}
@@ -0,0 +1,249 @@
+// Decoder for deimos binary traces (see trace_events.h). Prints one line per
+// record with its time since the start of the trace, then per-event counts
+// and span durations.
+//
+//   trace_decode <file.dtrc> [-s] [-chrome <out.json>]
+//
+// -s prints the summary only. -chrome also converts the trace to Chrome
+// trace-event JSON for Perfetto or chrome://tracing, as trace_format=chrome
+// records it on target. Times come from the TSC rate measured between the
+// first and last CLOCK records; a trace without two distinct clock ticks is
+// printed in raw TSC cycles instead (and exported as if 1 cycle were 1 us).
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_events.h"
+
+struct event_info {
+    const char *name;
+    int kind;
+    const char *args[DEIMOS_TRACE_ARGS];
+};
+
+#define TRACE_INFO(id, name, kind, a, b, c, d, e) {name, DEIMOS_TRACE_##kind, {a, b, c, d, e}},
+static const struct event_info g_events[DEIMOS_TEV_COUNT] = {DEIMOS_TRACE_EVENT_LIST(TRACE_INFO)};
+#undef TRACE_INFO
+
+struct span_stats {
+    uint64_t begin; // tsc of the open span; 0 when none is open
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+};
+
+struct reader {
+    FILE *f;
+    int eof;
+};
+
+static uint32_t get_u8(struct reader *r) {
+    int c = fgetc(r->f);
+    if (c == EOF) {
+        r->eof = 1;
+        return 0;
+    }
+    return (uint32_t)c;
+}
+
+static uint32_t get_u16(struct reader *r) {
+    uint32_t lo = get_u8(r);
+    return lo | (get_u8(r) << 8);
+}
+
+static uint32_t get_u32(struct reader *r) {
+    uint32_t lo = get_u16(r);
+    return lo | (get_u16(r) << 16);
+}
+
+static uint64_t get_u64(struct reader *r) {
+    uint64_t lo = get_u32(r);
+    return lo | ((uint64_t)get_u32(r) << 32);
+}
+
+// The BEGIN event sharing an END event's name, or -1.
+static int span_of(uint32_t event) {
+    for (int i = 0; i < DEIMOS_TEV_COUNT; i++) {
+        if (g_events[i].kind == DEIMOS_TRACE_BEGIN && strcmp(g_events[i].name, g_events[event].name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Same layout as the JSON trace.c writes.
+static int write_chrome(const char *path, const struct deimos_trace_record *recs, size_t count, double us_per_cycle) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"deimos\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main loop\"}}");
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        const struct deimos_trace_record *rec = &recs[i];
+        double ts = (double)(rec->tsc - recs[0].tsc) * us_per_cycle;
+        if (rec->event == DEIMOS_TEV_CLOCK) {
+            if (rec->args[2] == dropped) continue;
+            fprintf(f, ",\n{\"name\":\"trace_overrun\",\"ph\":\"i\",\"ts\":%.3f,\"pid\":1,\"tid\":1,"
+                       "\"s\":\"g\",\"args\":{\"lost\":%u}}",
+                    ts, rec->args[2] - dropped);
+            dropped = rec->args[2];
+            continue;
+        }
+        if (rec->event >= DEIMOS_TEV_COUNT) continue;
+
+        const struct event_info *info = &g_events[rec->event];
+        const char *phase = info->kind == DEIMOS_TRACE_BEGIN ? "B" : (info->kind == DEIMOS_TRACE_END ? "E" : "i");
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":1", info->name, phase, ts);
+        if (info->kind == DEIMOS_TRACE_INSTANT) fprintf(f, ",\"s\":\"t\"");
+        fprintf(f, ",\"args\":{");
+        int first = 1;
+        for (int a = 0; a < DEIMOS_TRACE_ARGS; a++) {
+            if (!info->args[a][0]) continue;
+            fprintf(f, "%s\"%s\":%u", first ? "" : ",", info->args[a], rec->args[a]);
+            first = 0;
+        }
+        fprintf(f, "}}");
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = 0;
+    const char *chrome = 0;
+    int summary_only = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            summary_only = 1;
+        } else if (strcmp(argv[i], "-chrome") == 0 && i + 1 < argc) {
+            chrome = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <file.dtrc> [-s] [-chrome <out.json>]\n", argv[0]);
+        return 2;
+    }
+
+    struct reader r = {fopen(path, "rb"), 0};
+    if (!r.f) {
+        perror(path);
+        return 1;
+    }
+    char magic[4];
+    for (int i = 0; i < 4; i++) magic[i] = (char)get_u8(&r);
+    uint32_t version = get_u32(&r);
+    uint32_t size = get_u32(&r);
+    if (r.eof || memcmp(magic, DEIMOS_TRACE_MAGIC, 4) != 0 || version != DEIMOS_TRACE_VERSION ||
+        size != sizeof(struct deimos_trace_record)) {
+        fprintf(stderr, "%s: not a version %d deimos trace\n", path, DEIMOS_TRACE_VERSION);
+        return 1;
+    }
+
+    size_t count = 0, cap = 0;
+    struct deimos_trace_record *recs = 0;
+    for (;;) {
+        struct deimos_trace_record rec;
+        rec.tsc = get_u64(&r);
+        rec.event = get_u32(&r);
+        for (int i = 0; i < DEIMOS_TRACE_ARGS; i++) rec.args[i] = get_u32(&r);
+        if (r.eof) break;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 4096;
+            recs = realloc(recs, cap * sizeof(*recs));
+            if (!recs) return 1;
+        }
+        recs[count++] = rec;
+    }
+    fclose(r.f);
+    if (count == 0) {
+        printf("%s: empty trace\n", path);
+        return 0;
+    }
+
+    // TSC rate from the outermost clock records (ticks run at 100 Hz).
+    int have_first = 0;
+    uint64_t tsc0 = 0, tick0 = 0, tsc1 = 0, tick1 = 0;
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (recs[i].event != DEIMOS_TEV_CLOCK) continue;
+        uint64_t t = recs[i].args[0] | ((uint64_t)recs[i].args[1] << 32);
+        if (!have_first) {
+            tsc0 = recs[i].tsc;
+            tick0 = t;
+            have_first = 1;
+        }
+        tsc1 = recs[i].tsc;
+        tick1 = t;
+        dropped = recs[i].args[2];
+    }
+    double cycles_per_ms = 0.0;
+    if (tick1 > tick0 && tsc1 > tsc0) cycles_per_ms = (double)(tsc1 - tsc0) / ((double)(tick1 - tick0) * 10.0);
+    const char *unit = cycles_per_ms > 0.0 ? "ms" : "cycles";
+    double scale = cycles_per_ms > 0.0 ? 1.0 / cycles_per_ms : 1.0;
+    if (chrome && !write_chrome(chrome, recs, count, cycles_per_ms > 0.0 ? 1000.0 / cycles_per_ms : 1.0)) {
+        fprintf(stderr, "cannot write %s\n", chrome);
+    }
+
+    uint64_t base = recs[0].tsc;
+    uint64_t counts[DEIMOS_TEV_COUNT] = {0};
+    struct span_stats spans[DEIMOS_TEV_COUNT];
+    memset(spans, 0, sizeof(spans));
+    uint32_t last_dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        const struct deimos_trace_record *rec = &recs[i];
+        if (rec->event >= DEIMOS_TEV_COUNT) {
+            if (!summary_only) printf("%12.3f %s  unknown event %u\n", (double)(rec->tsc - base) * scale, unit,
+                                      rec->event);
+            continue;
+        }
+        const struct event_info *info = &g_events[rec->event];
+        counts[rec->event]++;
+
+        double span = -1.0;
+        if (info->kind == DEIMOS_TRACE_BEGIN) {
+            spans[rec->event].begin = rec->tsc;
+        } else if (info->kind == DEIMOS_TRACE_END) {
+            int b = span_of(rec->event);
+            if (b >= 0 && spans[b].begin != 0 && rec->tsc >= spans[b].begin) {
+                uint64_t d = rec->tsc - spans[b].begin;
+                spans[b].count++;
+                spans[b].total += d;
+                if (d > spans[b].max) spans[b].max = d;
+                spans[b].begin = 0;
+                span = (double)d * scale;
+            }
+        }
+        if (rec->event == DEIMOS_TEV_CLOCK && rec->args[2] != last_dropped) {
+            printf("%12.3f %s  ** %u records lost to ring overrun\n", (double)(rec->tsc - base) * scale, unit,
+                   rec->args[2] - last_dropped);
+            last_dropped = rec->args[2];
+        }
+        if (summary_only) continue;
+
+        printf("%12.3f %s  %-14s %s", (double)(rec->tsc - base) * scale, unit, info->name,
+               info->kind == DEIMOS_TRACE_BEGIN ? "begin" : (info->kind == DEIMOS_TRACE_END ? "end  " : "     "));
+        for (int a = 0; a < DEIMOS_TRACE_ARGS; a++) {
+            if (info->args[a][0]) printf(" %s=%u", info->args[a], rec->args[a]);
+        }
+        if (span >= 0.0) printf(" (%.3f %s)", span, unit);
+        printf("\n");
+    }
+
+    printf("%zu records over %.3f %s, %u dropped\n", count, (double)(recs[count - 1].tsc - base) * scale, unit,
+           dropped);
+    for (int i = 0; i < DEIMOS_TEV_COUNT; i++) {
+        if (g_events[i].kind == DEIMOS_TRACE_END || counts[i] == 0) continue;
+        printf("  %-14s %8llu", g_events[i].name, (unsigned long long)counts[i]);
+        if (spans[i].count > 0) {
+            printf("  avg %.3f max %.3f %s", (double)spans[i].total / (double)spans[i].count * scale,
+                   (double)spans[i].max * scale, unit);
+        }
+        printf("\n");
+    }
+    free(recs);
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <libsys.h>
+
+#include "rendering/rendering.h"
+#include "trace.h"
+#include "util.h"
+
+#if DEIMOS_TRACE
+#define TRACE_JSON_BYTES (64 * 1024)
+#define TRACE_JSON_RECORD_MAX 512 // longest formatted record, with slack
+#define TRACE_CALIBRATE_TICKS 5
+
+struct deimos_trace_record *deimos_trace_ring; // frame pool, on first start
+uint32_t deimos_trace_head; // records emitted since start; wraps the ring
+int deimos_trace_on;
+
+struct trace_event_info {
+    const char *name;
+    int kind;
+    const char *args[DEIMOS_TRACE_ARGS];
+};
+
+#define TRACE_INFO(id, name, kind, a, b, c, d, e) {name, DEIMOS_TRACE_##kind, {a, b, c, d, e}},
+static const struct trace_event_info g_events[DEIMOS_TEV_COUNT] = {DEIMOS_TRACE_EVENT_LIST(TRACE_INFO)};
+#undef TRACE_INFO
+
+static int g_fd = -1;
+static int g_format;
+static uint32_t g_written; // records emitted and already written or dropped
+static uint32_t g_dropped;
+static uint64_t g_bytes;
+
+// Chrome output: records are formatted into g_json (frame pool, on the first
+// Chrome start), with timestamps in microseconds since g_base_tsc at the rate
+// measured by calibrate().
+static char *g_json;
+static int g_json_len;
+static uint64_t g_base_tsc;
+static uint64_t g_cycles_per_us;
+static uint32_t g_json_dropped; // overrun already reported
+
+static void fail(void) {
+    print("[deimos] trace: write failed, stopping\n");
+    deimos_trace_on = 0;
+    close(g_fd);
+    g_fd = -1;
+}
+
+static int write_all(const void *data, int len) {
+    const uint8_t *p = (const uint8_t *)data;
+    int done = 0;
+    while (done < len) {
+        int n = write(g_fd, &p[done], len - done);
+        if (n <= 0) {
+            fail();
+            return 0;
+        }
+        done += n;
+    }
+    g_bytes += (uint64_t)done;
+    return 1;
+}
+
+static void json_flush(void) {
+    if (g_json_len > 0 && g_fd >= 0) write_all(g_json, g_json_len);
+    g_json_len = 0;
+}
+
+static void json_str(const char *s) {
+    while (*s) g_json[g_json_len++] = *s++;
+}
+
+static void json_u64(uint64_t v) {
+    char tmp[20];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + (v % 10));
+        v /= 10;
+    } while (v > 0);
+    while (len > 0) g_json[g_json_len++] = tmp[--len];
+}
+
+// Microseconds with three decimals, as the trace-event format expects.
+static void json_timestamp(uint64_t tsc) {
+    uint64_t cycles = tsc > g_base_tsc ? tsc - g_base_tsc : 0;
+    uint64_t frac = ((cycles % g_cycles_per_us) * 1000U) / g_cycles_per_us;
+    json_u64(cycles / g_cycles_per_us);
+    g_json[g_json_len++] = '.';
+    g_json[g_json_len++] = (char)('0' + frac / 100);
+    g_json[g_json_len++] = (char)('0' + (frac / 10) % 10);
+    g_json[g_json_len++] = (char)('0' + frac % 10);
+}
+
+static void json_event(const char *name, const char *phase, uint64_t tsc) {
+    if (g_json_len > TRACE_JSON_BYTES - TRACE_JSON_RECORD_MAX) json_flush();
+    json_str(",\n{\"name\":\"");
+    json_str(name);
+    json_str("\",\"ph\":\"");
+    json_str(phase);
+    json_str("\",\"ts\":");
+    json_timestamp(tsc);
+    json_str(",\"pid\":1,\"tid\":1");
+}
+
+static void json_record(const struct deimos_trace_record *r) {
+    if (r->event == DEIMOS_TEV_CLOCK) {
+        // Clock records only calibrate binary traces; an overrun is worth a mark.
+        if (r->args[2] == g_json_dropped) return;
+        json_event("trace_overrun", "i", r->tsc);
+        json_str(",\"s\":\"g\",\"args\":{\"lost\":");
+        json_u64(r->args[2] - g_json_dropped);
+        json_str("}}");
+        g_json_dropped = r->args[2];
+        return;
+    }
+    if (r->event >= DEIMOS_TEV_COUNT) return;
+
+    const struct trace_event_info *info = &g_events[r->event];
+    const char *phase = info->kind == DEIMOS_TRACE_BEGIN ? "B" : (info->kind == DEIMOS_TRACE_END ? "E" : "i");
+    json_event(info->name, phase, r->tsc);
+    if (info->kind == DEIMOS_TRACE_INSTANT) json_str(",\"s\":\"t\"");
+    json_str(",\"args\":{");
+    int first = 1;
+    for (int a = 0; a < DEIMOS_TRACE_ARGS; a++) {
+        if (!info->args[a][0]) continue;
+        json_str(first ? "\"" : ",\"");
+        json_str(info->args[a]);
+        json_str("\":");
+        json_u64(r->args[a]);
+        first = 0;
+    }
+    json_str("}}");
+}
+
+static void write_records(uint32_t start, uint32_t count) {
+    if (g_format == DEIMOS_TRACE_FORMAT_BINARY) {
+        write_all(&deimos_trace_ring[start], (int)(count * sizeof(struct deimos_trace_record)));
+        return;
+    }
+    for (uint32_t i = 0; i < count && g_fd >= 0; i++) {
+        json_record(&deimos_trace_ring[start + i]);
+    }
+    json_flush();
+}
+
+static void emit_clock(void) {
+    uint64_t t = ticks();
+    DEIMOS_TRACE3(CLOCK, t, t >> 32, g_dropped);
+}
+
+// Writes everything emitted so far. Records the writer has lapped are gone;
+// they are counted and the next CLOCK record reports the total.
+static void write_pending(void) {
+    uint32_t pending = deimos_trace_head - g_written;
+    if (pending > DEIMOS_TRACE_RING) {
+        g_dropped += pending - DEIMOS_TRACE_RING;
+        g_written = deimos_trace_head - DEIMOS_TRACE_RING;
+    }
+    while (g_fd >= 0 && g_written != deimos_trace_head) {
+        uint32_t start = g_written & (DEIMOS_TRACE_RING - 1);
+        uint32_t count = deimos_trace_head - g_written;
+        if (count > DEIMOS_TRACE_RING - start) count = DEIMOS_TRACE_RING - start;
+        write_records(start, count);
+        g_written += count;
+    }
+}
+
+// TSC cycles per microsecond over TRACE_CALIBRATE_TICKS timer ticks, timed
+// from a tick edge so the partial first tick does not count.
+static uint64_t calibrate(void) {
+    uint64_t t0 = ticks();
+    while (ticks() == t0) yield();
+    uint64_t begin = deimos_tsc();
+    uint64_t t1 = ticks();
+    while (ticks() - t1 < TRACE_CALIBRATE_TICKS) yield();
+    uint64_t elapsed_us = (ticks() - t1) * 10000U;
+    uint64_t rate = (deimos_tsc() - begin) / elapsed_us;
+    return rate > 0 ? rate : 1;
+}
+
+static int write_header(void) {
+    if (g_format == DEIMOS_TRACE_FORMAT_CHROME) {
+        g_json_len = 0;
+        g_json_dropped = 0;
+        g_cycles_per_us = calibrate();
+        g_base_tsc = deimos_tsc();
+        json_str("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        json_str("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"deimos\"}},\n");
+        json_str("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main loop\"}}");
+        json_flush();
+        return g_fd >= 0;
+    }
+
+    uint32_t size = (uint32_t)sizeof(struct deimos_trace_record);
+    uint8_t header[12] = {
+        (uint8_t)DEIMOS_TRACE_MAGIC[0], (uint8_t)DEIMOS_TRACE_MAGIC[1], (uint8_t)DEIMOS_TRACE_MAGIC[2],
+        (uint8_t)DEIMOS_TRACE_MAGIC[3], (uint8_t)DEIMOS_TRACE_VERSION, 0, 0, 0,
+        (uint8_t)size, (uint8_t)(size >> 8), 0, 0,
+    };
+    return write_all(header, (int)sizeof(header));
+}
+
+// Carves the ring, and for Chrome output the JSON buffer, from the frame pool
+// the first time they are needed; later starts reuse them.
+static int reserve(int format) {
+    if (!deimos_trace_ring) {
+        deimos_trace_ring = (struct deimos_trace_record *)render_frame_alloc(
+            (uint32_t)(DEIMOS_TRACE_RING * sizeof(struct deimos_trace_record)));
+    }
+    if (!g_json && format == DEIMOS_TRACE_FORMAT_CHROME) g_json = (char *)render_frame_alloc(TRACE_JSON_BYTES);
+    if (deimos_trace_ring && (g_json || format != DEIMOS_TRACE_FORMAT_CHROME)) return 1;
+    print("[deimos] trace: frame pool too small for the trace ring, raise FRAME_POOL_MB\n");
+    return 0;
+}
+
+int deimos_trace_start(const char *path, int format) {
+    if (!path || !path[0] || g_fd >= 0) return -1;
+    format = format == DEIMOS_TRACE_FORMAT_CHROME ? DEIMOS_TRACE_FORMAT_CHROME : DEIMOS_TRACE_FORMAT_BINARY;
+    if (!reserve(format)) return -1;
+
+    g_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (g_fd < 0) {
+        print("[deimos] trace: cannot open ");
+        print(path);
+        print("\n");
+        return -1;
+    }
+
+    g_format = format;
+    deimos_trace_head = 0;
+    g_written = 0;
+    g_dropped = 0;
+    g_bytes = 0;
+    if (!write_header()) return -1;
+
+    deimos_trace_on = 1;
+    emit_clock();
+    print(g_format == DEIMOS_TRACE_FORMAT_CHROME ? "[deimos] trace: recording Chrome JSON to "
+                                                 : "[deimos] trace: recording to ");
+    print(path);
+    print("\n");
+    return 0;
+}
+
+void deimos_trace_flush(void) {
+    if (g_fd < 0 || deimos_trace_head - g_written < DEIMOS_TRACE_FLUSH_RECORDS) return;
+    emit_clock();
+    write_pending();
+}
+
+void deimos_trace_stop(void) {
+    if (g_fd < 0) return;
+    emit_clock();
+    deimos_trace_on = 0;
+    write_pending();
+    if (g_format == DEIMOS_TRACE_FORMAT_CHROME && g_fd >= 0) {
+        json_str("\n]}\n");
+        json_flush();
+    }
+    if (g_fd >= 0) {
+        close(g_fd);
+        g_fd = -1;
+    }
+
+    char line[DEIMOS_LINE];
+    int n = 0;
+    n = deimos_append_str(line, n, "[deimos] trace: ");
+    n = deimos_append_u32(line, n, deimos_trace_head - g_dropped);
+    n = deimos_append_str(line, n, " records, ");
+    n = deimos_append_u32(line, n, g_dropped);
+    n = deimos_append_str(line, n, " dropped, ");
+    n = deimos_append_u32(line, n, (uint32_t)(g_bytes / 1024U));
+    n = deimos_append_str(line, n, " KiB\n");
+    line[n] = '\0';
+    print(line);
+}
+#else
+int deimos_trace_start(const char *path, int format) {
+    (void)format;
+    if (path && path[0]) print("[deimos] trace: built with TRACE=0, not recording\n");
+    return -1;
+}
+
+void deimos_trace_flush(void) {
+}
+
+void deimos_trace_stop(void) {
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef DEIMOS_TRACE_H
+#define DEIMOS_TRACE_H
+
+#include <stdint.h>
+#include "trace_events.h"
+#include "util.h"
+
+// Binary tracing for hot paths. A trace point stores a TSC timestamp, an
+// event id and up to five integers into a ring of fixed-size records and
+// formats nothing; deimos_trace_flush writes pending records out from the
+// main loop and tools/trace_decode turns them into text offline. Deimos runs
+// one thread, so the ring has a single writer and needs no synchronisation.
+//
+// Build with TRACE=0 (DEIMOS_TRACE=0) to compile every trace point out; the
+// arguments are then not evaluated either.
+#ifndef DEIMOS_TRACE
+#define DEIMOS_TRACE 1
+#endif
+
+#define DEIMOS_TRACE_RING 65536         // records, power of two (2 MiB, frame pool)
+#define DEIMOS_TRACE_FLUSH_RECORDS 4096 // pending records that trigger a write
+
+// Output formats: the compact binary stream, or Chrome trace-event JSON that
+// Perfetto and chrome://tracing open directly. JSON is formatted at flush
+// time, never at the trace point.
+#define DEIMOS_TRACE_FORMAT_BINARY 0
+#define DEIMOS_TRACE_FORMAT_CHROME 1
+
+// Starts recording to path; 0 on success. The first start carves the ring
+// from the frame pool (render_frame_alloc), so call it after render_init;
+// builds that never trace spend no memory on it. Without a started trace,
+// trace points cost one predictable branch. Chrome output first spends ~50 ms
+// measuring the TSC rate, since its timestamps are in microseconds.
+int deimos_trace_start(const char *path, int format);
+// Off the hot path (once per loop iteration): writes pending records once
+// DEIMOS_TRACE_FLUSH_RECORDS have accumulated.
+void deimos_trace_flush(void);
+// Writes everything still pending and closes the file.
+void deimos_trace_stop(void);
+
+#if DEIMOS_TRACE
+extern struct deimos_trace_record *deimos_trace_ring;
+extern uint32_t deimos_trace_head;
+extern int deimos_trace_on;
+
+static inline void deimos_trace_emit(uint32_t event, uint32_t a, uint32_t b, uint32_t c, uint32_t d,
+                                     uint32_t e) {
+    if (!deimos_trace_on) return;
+    struct deimos_trace_record *r = &deimos_trace_ring[deimos_trace_head++ & (DEIMOS_TRACE_RING - 1)];
+    r->tsc = deimos_tsc();
+    r->event = event;
+    r->args[0] = a;
+    r->args[1] = b;
+    r->args[2] = c;
+    r->args[3] = d;
+    r->args[4] = e;
+}
+
+#define DEIMOS_TRACE0(ev) deimos_trace_emit(DEIMOS_TEV_##ev, 0, 0, 0, 0, 0)
+#define DEIMOS_TRACE1(ev, a) deimos_trace_emit(DEIMOS_TEV_##ev, (uint32_t)(a), 0, 0, 0, 0)
+#define DEIMOS_TRACE2(ev, a, b) deimos_trace_emit(DEIMOS_TEV_##ev, (uint32_t)(a), (uint32_t)(b), 0, 0, 0)
+#define DEIMOS_TRACE3(ev, a, b, c) \
+    deimos_trace_emit(DEIMOS_TEV_##ev, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0, 0)
+#define DEIMOS_TRACE4(ev, a, b, c, d) \
+    deimos_trace_emit(DEIMOS_TEV_##ev, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d), 0)
+#define DEIMOS_TRACE5(ev, a, b, c, d, e) \
+    deimos_trace_emit(DEIMOS_TEV_##ev, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d), (uint32_t)(e))
+#else
+// sizeof keeps the arguments referenced without evaluating them.
+#define DEIMOS_TRACE0(ev) ((void)0)
+#define DEIMOS_TRACE1(ev, a) ((void)sizeof(a))
+#define DEIMOS_TRACE2(ev, a, b) ((void)(sizeof(a) + sizeof(b)))
+#define DEIMOS_TRACE3(ev, a, b, c) ((void)(sizeof(a) + sizeof(b) + sizeof(c)))
+#define DEIMOS_TRACE4(ev, a, b, c, d) ((void)(sizeof(a) + sizeof(b) + sizeof(c) + sizeof(d)))
+#define DEIMOS_TRACE5(ev, a, b, c, d, e) ((void)(sizeof(a) + sizeof(b) + sizeof(c) + sizeof(d) + sizeof(e)))
+#endif
+
+#endif
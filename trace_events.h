@@ -0,0 +1,67 @@
+#ifndef DEIMOS_TRACE_EVENTS_H
+#define DEIMOS_TRACE_EVENTS_H
+
+#include <stdint.h>
+
+// File format of deimos traces (trace.c) and their decoder
+// (tools/trace_decode.c). All integers are little endian.
+//
+//   header:  "DTRC", u32 version, u32 record size
+//   records: struct deimos_trace_record, oldest first
+//
+// Timestamps are raw TSC. CLOCK records pair the TSC with ticks() (100 Hz)
+// at the start and at every flush, so decoders convert to time from the
+// first and last of them; their third argument is the running count of
+// records lost to ring overrun.
+#define DEIMOS_TRACE_MAGIC "DTRC"
+#define DEIMOS_TRACE_VERSION 1
+#define DEIMOS_TRACE_ARGS 5
+
+struct deimos_trace_record {
+    uint64_t tsc;
+    uint32_t event;
+    uint32_t args[DEIMOS_TRACE_ARGS];
+};
+
+// Event kinds: begin/end records bracket a span of the same name.
+#define DEIMOS_TRACE_INSTANT 0
+#define DEIMOS_TRACE_BEGIN 1
+#define DEIMOS_TRACE_END 2
+
+// X(id, name, kind, arg names...); unused arguments are named "". Spans nest:
+// frame holds input_drain, layout and compose, compose holds draw_window, and
+// yield follows the frame. New events go at the end so ids stay stable.
+#define DEIMOS_TRACE_EVENT_LIST(X) \
+    X(CLOCK, "clock", INSTANT, "ticks_lo", "ticks_hi", "dropped", "", "") \
+    X(INPUT, "input", INSTANT, "type", "x", "y", "key", "pressed") \
+    X(LAYOUT_BEGIN, "layout", BEGIN, "windows", "", "", "", "") \
+    X(LAYOUT_END, "layout", END, "", "", "", "", "") \
+    X(COMPOSE_BEGIN, "compose", BEGIN, "output", "full", "rects", "", "") \
+    X(COMPOSE_END, "compose", END, "output", "", "", "", "") \
+    X(VERIFY, "verify", INSTANT, "output", "mismatches", "", "", "") \
+    X(PRESENT, "present", INSTANT, "output", "rects", "pixels", "buffer", "") \
+    X(REPAIR, "repair", INSTANT, "output", "buffer", "pixels", "full", "") \
+    X(STALL, "present_stall", INSTANT, "output", "buffer", "", "", "") \
+    X(PUMP_BEGIN, "present_pump", BEGIN, "budget", "", "", "", "") \
+    X(PUMP_END, "present_pump", END, "pixels", "", "", "", "") \
+    X(GOVERNOR, "governor", INSTANT, "from", "to", "", "", "") \
+    X(WORKSPACE, "workspace", INSTANT, "from", "to", "", "", "") \
+    X(CAPTURE, "capture", INSTANT, "frame", "rects", "", "", "") \
+    X(REMOTE, "remote", INSTANT, "serial", "bytes", "", "", "") \
+    X(FRAME_BEGIN, "frame", BEGIN, "frame", "", "", "", "") \
+    X(FRAME_END, "frame", END, "drew", "", "", "", "") \
+    X(INPUT_DRAIN_BEGIN, "input_drain", BEGIN, "", "", "", "", "") \
+    X(INPUT_DRAIN_END, "input_drain", END, "events", "", "", "", "") \
+    X(WINDOW_BEGIN, "draw_window", BEGIN, "window", "rects", "floating", "", "") \
+    X(WINDOW_END, "draw_window", END, "window", "", "", "", "") \
+    X(YIELD_BEGIN, "yield", BEGIN, "", "", "", "", "") \
+    X(YIELD_END, "yield", END, "", "", "", "", "")
+
+#define DEIMOS_TRACE_ENUM(id, name, kind, a, b, c, d, e) DEIMOS_TEV_##id,
+enum deimos_trace_event {
+    DEIMOS_TRACE_EVENT_LIST(DEIMOS_TRACE_ENUM)
+    DEIMOS_TEV_COUNT
+};
+#undef DEIMOS_TRACE_ENUM
+
+#endif
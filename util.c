@@ -0,0 +1,27 @@
+#include "util.h"
+
+#define LINE_TEXT_MAX (DEIMOS_LINE - 2)
+
+int deimos_append_str(char *line, int n, const char *s) {
+    while (*s && n < LINE_TEXT_MAX) line[n++] = *s++;
+    return n;
+}
+
+int deimos_append_u32(char *line, int n, uint32_t v) {
+    char tmp[10];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + (v % 10));
+        v /= 10;
+    } while (v > 0 && len < 10);
+    while (len > 0 && n < LINE_TEXT_MAX) line[n++] = tmp[--len];
+    return n;
+}
+
+int deimos_append_int(char *line, int n, int v) {
+    if (v < 0) {
+        n = deimos_append_str(line, n, "-");
+        return deimos_append_u32(line, n, (uint32_t)0 - (uint32_t)v);
+    }
+    return deimos_append_u32(line, n, (uint32_t)v);
+}
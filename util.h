@@ -0,0 +1,31 @@
+#ifndef DEIMOS_UTIL_H
+#define DEIMOS_UTIL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cycle counter for timing hot paths; callers calibrate it against ticks().
+static inline uint64_t deimos_tsc(void) {
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Status lines for print() are built in char[DEIMOS_LINE] buffers. The append
+// helpers write at index n and return the new length; they stop short of the
+// end so a trailing "\n" and the terminator always fit.
+#define DEIMOS_LINE 128
+
+int deimos_append_str(char *line, int n, const char *s);
+int deimos_append_u32(char *line, int n, uint32_t v);
+int deimos_append_int(char *line, int n, int v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,9 +1,28 @@
 #include <libsys.h>
 #include <stdint.h>
 
-static struct user_input_event g_ev;
-int deimos_input_poll(void) { return input_poll(&g_ev); }
-int deimos_input_key(void) { return g_ev.key; }
-int deimos_input_mods(void) { return g_ev.modifiers; }
-int deimos_input_pressed(void) { return g_ev.pressed; }
-int deimos_input_scancode(void) { return g_ev.scancode; }
\ No newline at end of file
+#include "input_queue.h"
+
+// mt-lang reads input one field at a time. Events come from the input queue a
+// batch at a time, so the accessors read local memory instead of each event
+// costing a syscall. The bridge is the queue's consumer when the mt-lang
+// window manager drives input, and collects before each refill itself.
+static struct deimos_input_item g_batch[DEIMOS_INPUT_BATCH];
+static int g_count;
+static int g_next;
+
+int deimos_input_poll(void) {
+    if (g_next >= g_count) {
+        deimos_input_collect();
+        g_count = deimos_input_drain(g_batch, DEIMOS_INPUT_BATCH);
+        g_next = 0;
+        if (g_count == 0) return 0;
+    }
+    g_next++;
+    return 1;
+}
+
+int deimos_input_key(void) { return g_next > 0 ? g_batch[g_next - 1].ev.key : 0; }
+int deimos_input_mods(void) { return g_next > 0 ? g_batch[g_next - 1].ev.modifiers : 0; }
+int deimos_input_pressed(void) { return g_next > 0 ? g_batch[g_next - 1].ev.pressed : 0; }
+int deimos_input_scancode(void) { return g_next > 0 ? g_batch[g_next - 1].ev.scancode : 0; }
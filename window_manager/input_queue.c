@@ -0,0 +1,61 @@
+#include "input_queue.h"
+#include "util.h"
+
+static struct deimos_input_item g_ring[DEIMOS_INPUT_QUEUE];
+static uint32_t g_head; // written by the producer only
+static uint32_t g_tail; // written by the consumer only
+static struct deimos_input_stats g_stats; // each field has a single writer
+
+int deimos_input_collect(void) {
+    uint32_t head = g_head;
+    uint32_t tail = __atomic_load_n(&g_tail, __ATOMIC_ACQUIRE);
+    int collected = 0;
+
+    for (;;) {
+        if (head - tail == DEIMOS_INPUT_QUEUE) {
+            // Full: stop polling. The rest stays queued in the kernel, in
+            // order, until the consumer frees slots.
+            g_stats.full++;
+            break;
+        }
+        struct deimos_input_item *item = &g_ring[head & (DEIMOS_INPUT_QUEUE - 1)];
+        if (input_poll(&item->ev) != 1) break;
+        item->tsc = deimos_tsc();
+        head++;
+        collected++;
+    }
+
+    if (collected > 0) {
+        __atomic_store_n(&g_head, head, __ATOMIC_RELEASE);
+        g_stats.collected += (uint32_t)collected;
+        if (head - tail > g_stats.max_depth) g_stats.max_depth = head - tail;
+    }
+    return collected;
+}
+
+int deimos_input_drain(struct deimos_input_item *out, int max) {
+    if (!out || max <= 0) return 0;
+    uint32_t tail = g_tail;
+    uint32_t head = __atomic_load_n(&g_head, __ATOMIC_ACQUIRE);
+    uint32_t count = head - tail;
+    if (count == 0) return 0;
+    if (count > (uint32_t)max) count = (uint32_t)max;
+
+    uint64_t now = deimos_tsc();
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = g_ring[(tail + i) & (DEIMOS_INPUT_QUEUE - 1)];
+    }
+    __atomic_store_n(&g_tail, tail + count, __ATOMIC_RELEASE);
+
+    // The oldest event of the batch waited longest.
+    if (now > out[0].tsc && now - out[0].tsc > g_stats.max_wait_cycles) {
+        g_stats.max_wait_cycles = now - out[0].tsc;
+    }
+    g_stats.batches++;
+    return (int)count;
+}
+
+void deimos_input_get_stats(struct deimos_input_stats *out) {
+    if (!out) return;
+    *out = g_stats;
+}
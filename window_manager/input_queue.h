@@ -0,0 +1,44 @@
+#ifndef DEIMOS_WM_INPUT_QUEUE_H
+#define DEIMOS_WM_INPUT_QUEUE_H
+
+#include <stdint.h>
+#include <libsys.h>
+
+// Single-producer/single-consumer input ring. The producer collects events
+// from input_poll, stamps them with the TSC and publishes them with a release
+// store of the head; the consumer takes them in batches and releases slots
+// with a store of the tail. Neither side takes a lock or writes the other's
+// index, so the two may run on different threads.
+//
+// libsys has no thread creation yet, so for now the producer runs at
+// collection points in the main loop (frame start, after each output and
+// around present pumps): a long frame no longer leaves events waiting in the
+// kernel until the next frame starts, and each one carries when it was
+// collected rather than when the frame got to it.
+#define DEIMOS_INPUT_QUEUE 256 // events, power of two
+#define DEIMOS_INPUT_BATCH 64  // events a consumer takes per drain
+
+struct deimos_input_item {
+    struct user_input_event ev;
+    uint64_t tsc; // when the producer collected it
+};
+
+struct deimos_input_stats {
+    uint32_t collected;
+    uint32_t full; // collections stopped at a full ring; the rest waited in the kernel
+    uint32_t batches;
+    uint32_t max_depth;
+    uint64_t max_wait_cycles; // collection to drain, worst case
+};
+
+// Producer: moves what input_poll has into the ring, stopping when it is full
+// so no event is lost; returns the count.
+int deimos_input_collect(void);
+
+// Consumer: copies up to max of the oldest events into out and frees their
+// slots; returns the count.
+int deimos_input_drain(struct deimos_input_item *out, int max);
+
+void deimos_input_get_stats(struct deimos_input_stats *out);
+
+#endif
@@ -1,106 +1,342 @@
 #include "state.h"
 
-static int g_window_count = 0;
-static int g_focused_window_id = -1;
-static int g_split_x[DEIMOS_MAX_WINDOWS];
-static int g_split_y[DEIMOS_MAX_WINDOWS];
-static int g_split_target_mode[DEIMOS_MAX_WINDOWS];
-static int g_split_target_id[DEIMOS_MAX_WINDOWS];
+// Each workspace owns its own window set, split table, focus and z order.
+// Window ids are per workspace (1..window_count); the accessors below always
+// read the active workspace.
+struct deimos_wm_workspace {
+    int window_count;
+    int focused_window_id;
+    int split_x[DEIMOS_MAX_WINDOWS];
+    int split_y[DEIMOS_MAX_WINDOWS];
+    int split_target_mode[DEIMOS_MAX_WINDOWS];
+    int split_target_id[DEIMOS_MAX_WINDOWS];
+    int split_ratio[DEIMOS_MAX_WINDOWS];
+    int split_orient[DEIMOS_MAX_WINDOWS];
+    int split_side[DEIMOS_MAX_WINDOWS];
+    int split_pinned_target_id[DEIMOS_MAX_WINDOWS];
+    int window_floating[DEIMOS_MAX_WINDOWS];
+    int float_x[DEIMOS_MAX_WINDOWS];
+    int float_y[DEIMOS_MAX_WINDOWS];
+    int float_w[DEIMOS_MAX_WINDOWS];
+    int float_h[DEIMOS_MAX_WINDOWS];
+    int z_order[DEIMOS_MAX_WINDOWS]; // window ids, bottom to top
+    int z_count;
+};
 
-void deimos_wm_init(int default_x, int default_y) {
-    g_window_count = 0;
-    g_focused_window_id = -1;
+static struct deimos_wm_workspace g_workspaces[DEIMOS_MAX_WORKSPACES];
+static struct deimos_wm_workspace *g_ws = &g_workspaces[0];
+static int g_workspace_index = 0;
+static int g_stacking_serial = 0;
+
+static void reset_split_pin(int index) {
+    g_ws->split_orient[index] = DEIMOS_SPLIT_ORIENT_AUTO;
+    g_ws->split_side[index] = -1;
+    g_ws->split_pinned_target_id[index] = -1;
+}
+
+static void init_workspace(struct deimos_wm_workspace *ws, int default_x, int default_y) {
+    ws->window_count = 0;
+    ws->focused_window_id = -1;
+    ws->z_count = 0;
 
     for (int i = 0; i < DEIMOS_MAX_WINDOWS; i++) {
-        g_split_x[i] = default_x;
-        g_split_y[i] = default_y;
-        g_split_target_mode[i] = DEIMOS_SPLIT_TARGET_MOUSE;
-        g_split_target_id[i] = -1;
+        ws->split_x[i] = default_x;
+        ws->split_y[i] = default_y;
+        ws->split_target_mode[i] = DEIMOS_SPLIT_TARGET_MOUSE;
+        ws->split_target_id[i] = -1;
+        ws->split_ratio[i] = DEIMOS_SPLIT_RATIO_DEFAULT;
+        ws->split_orient[i] = DEIMOS_SPLIT_ORIENT_AUTO;
+        ws->split_side[i] = -1;
+        ws->split_pinned_target_id[i] = -1;
+        ws->window_floating[i] = 0;
+    }
+}
+
+void deimos_wm_init(int default_x, int default_y) {
+    for (int i = 0; i < DEIMOS_MAX_WORKSPACES; i++) {
+        init_workspace(&g_workspaces[i], default_x, default_y);
     }
+    g_workspace_index = 0;
+    g_ws = &g_workspaces[0];
+    g_stacking_serial++;
+}
+
+int deimos_wm_workspace(void) {
+    return g_workspace_index;
+}
+
+int deimos_wm_switch_workspace(int workspace) {
+    if (workspace < 0 || workspace >= DEIMOS_MAX_WORKSPACES) {
+        return 0;
+    }
+    if (workspace == g_workspace_index) {
+        return 0;
+    }
+
+    g_workspace_index = workspace;
+    g_ws = &g_workspaces[workspace];
+    g_stacking_serial++;
+    return 1;
 }
 
 int deimos_wm_window_count(void) {
-    return g_window_count;
+    return g_ws->window_count;
 }
 
 void deimos_wm_add_window_split(int x, int y, int target_mode) {
-    if (g_window_count < 0 || g_window_count >= DEIMOS_MAX_WINDOWS) {
+    if (g_ws->window_count < 0 || g_ws->window_count >= DEIMOS_MAX_WINDOWS) {
         return;
     }
 
-    int index = g_window_count;
-    g_split_x[index] = x;
-    g_split_y[index] = y;
-    g_split_target_mode[index] = target_mode;
+    int index = g_ws->window_count;
+    g_ws->split_x[index] = x;
+    g_ws->split_y[index] = y;
+    g_ws->split_target_mode[index] = target_mode;
     if (target_mode == DEIMOS_SPLIT_TARGET_FOCUS) {
-        g_split_target_id[index] = g_focused_window_id;
+        g_ws->split_target_id[index] = g_ws->focused_window_id;
     } else {
-        g_split_target_id[index] = -1;
+        g_ws->split_target_id[index] = -1;
     }
+    g_ws->split_ratio[index] = DEIMOS_SPLIT_RATIO_DEFAULT;
+    reset_split_pin(index);
+    g_ws->window_floating[index] = 0;
 
     // Window IDs are assigned in compositor from 1..N.
-    g_focused_window_id = index + 1;
-    g_window_count++;
+    g_ws->focused_window_id = index + 1;
+    g_ws->window_count++;
+    g_ws->z_order[g_ws->z_count++] = index + 1;
+    g_stacking_serial++;
 }
 
 int deimos_wm_set_focus_window_id(int window_id) {
-    int next_focus = g_focused_window_id;
+    int next_focus = g_ws->focused_window_id;
 
-    if (window_id >= 1 && window_id <= g_window_count) {
+    if (window_id >= 1 && window_id <= g_ws->window_count) {
         next_focus = window_id;
     }
 
-    if (next_focus == g_focused_window_id) {
+    if (next_focus == g_ws->focused_window_id) {
         return 0;
     }
 
-    g_focused_window_id = next_focus;
+    g_ws->focused_window_id = next_focus;
+    if (g_ws->window_floating[next_focus - 1]) {
+        deimos_wm_raise_window(next_focus);
+    }
     return 1;
 }
 
 int deimos_wm_set_split_for_window_id(int window_id, int x, int y) {
     int index = window_id - 1;
-    if (index < 0 || index >= g_window_count || index >= DEIMOS_MAX_WINDOWS) {
+    if (index < 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+
+    if (g_ws->split_x[index] == x && g_ws->split_y[index] == y) {
         return 0;
     }
 
-    if (g_split_x[index] == x && g_split_y[index] == y) {
+    g_ws->split_x[index] = x;
+    g_ws->split_y[index] = y;
+    // Re-targeting by drop resolves the split from the point again.
+    reset_split_pin(index);
+    return 1;
+}
+
+int deimos_wm_set_split_ratio(int index, int permille) {
+    if (index <= 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
         return 0;
     }
 
-    g_split_x[index] = x;
-    g_split_y[index] = y;
+    if (permille < DEIMOS_SPLIT_RATIO_MIN) permille = DEIMOS_SPLIT_RATIO_MIN;
+    if (permille > DEIMOS_SPLIT_RATIO_MAX) permille = DEIMOS_SPLIT_RATIO_MAX;
+    if (g_ws->split_ratio[index] == permille) {
+        return 0;
+    }
+
+    g_ws->split_ratio[index] = permille;
     return 1;
 }
 
+void deimos_wm_pin_split(int index, int target_id, int orient, int side) {
+    if (index <= 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
+        return;
+    }
+
+    g_ws->split_pinned_target_id[index] = target_id;
+    g_ws->split_orient[index] = orient;
+    g_ws->split_side[index] = side;
+}
+
+int deimos_wm_toggle_floating(int window_id, int x, int y, int w, int h) {
+    int index = window_id - 1;
+    if (index < 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+
+    if (g_ws->window_floating[index]) {
+        g_ws->window_floating[index] = 0;
+    } else {
+        if (w < 32) w = 32;
+        if (h < 24) h = 24;
+        g_ws->window_floating[index] = 1;
+        g_ws->float_x[index] = x;
+        g_ws->float_y[index] = y;
+        g_ws->float_w[index] = w;
+        g_ws->float_h[index] = h;
+        deimos_wm_raise_window(window_id);
+    }
+    g_stacking_serial++;
+    return 1;
+}
+
+int deimos_wm_set_float_position(int window_id, int x, int y) {
+    int index = window_id - 1;
+    if (index < 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    if (!g_ws->window_floating[index]) {
+        return 0;
+    }
+    if (g_ws->float_x[index] == x && g_ws->float_y[index] == y) {
+        return 0;
+    }
+
+    g_ws->float_x[index] = x;
+    g_ws->float_y[index] = y;
+    return 1;
+}
+
+int deimos_wm_raise_window(int window_id) {
+    int slot = -1;
+    for (int i = 0; i < g_ws->z_count; i++) {
+        if (g_ws->z_order[i] == window_id) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0 || slot == g_ws->z_count - 1) {
+        return 0;
+    }
+
+    for (int i = slot; i < g_ws->z_count - 1; i++) {
+        g_ws->z_order[i] = g_ws->z_order[i + 1];
+    }
+    g_ws->z_order[g_ws->z_count - 1] = window_id;
+    g_stacking_serial++;
+    return 1;
+}
+
+int deimos_wm_is_floating(int window_id) {
+    return deimos_window_floating(window_id - 1);
+}
+
+int deimos_wm_z_count(void) {
+    return g_ws->z_count;
+}
+
+int deimos_wm_z_window_id(int slot) {
+    if (slot < 0 || slot >= g_ws->z_count) {
+        return -1;
+    }
+    return g_ws->z_order[slot];
+}
+
+int deimos_wm_stacking_serial(void) {
+    return g_stacking_serial;
+}
+
 int deimos_split_x(int index) {
     if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
         return 0;
     }
-    return g_split_x[index];
+    return g_ws->split_x[index];
 }
 
 int deimos_split_y(int index) {
     if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
         return 0;
     }
-    return g_split_y[index];
+    return g_ws->split_y[index];
 }
 
 int deimos_split_target_mode(int index) {
     if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
         return DEIMOS_SPLIT_TARGET_MOUSE;
     }
-    return g_split_target_mode[index];
+    return g_ws->split_target_mode[index];
 }
 
 int deimos_split_target_id(int index) {
     if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
         return -1;
     }
-    return g_split_target_id[index];
+    return g_ws->split_target_id[index];
+}
+
+int deimos_split_ratio(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return DEIMOS_SPLIT_RATIO_DEFAULT;
+    }
+    return g_ws->split_ratio[index];
+}
+
+int deimos_split_orient(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return DEIMOS_SPLIT_ORIENT_AUTO;
+    }
+    return g_ws->split_orient[index];
+}
+
+int deimos_split_side(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return -1;
+    }
+    return g_ws->split_side[index];
+}
+
+int deimos_split_pinned_target_id(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return -1;
+    }
+    return g_ws->split_pinned_target_id[index];
+}
+
+int deimos_window_floating(int index) {
+    if (index < 0 || index >= g_ws->window_count || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    return g_ws->window_floating[index];
+}
+
+int deimos_float_x(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    return g_ws->float_x[index];
+}
+
+int deimos_float_y(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    return g_ws->float_y[index];
+}
+
+int deimos_float_w(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    return g_ws->float_w[index];
+}
+
+int deimos_float_h(int index) {
+    if (index < 0 || index >= DEIMOS_MAX_WINDOWS) {
+        return 0;
+    }
+    return g_ws->float_h[index];
 }
 
 int deimos_focus_window_id(void) {
-    return g_focused_window_id;
+    return g_ws->focused_window_id;
 }
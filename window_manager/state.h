@@ -2,21 +2,57 @@
 #define DEIMOS_WM_STATE_H
 
 #define DEIMOS_MAX_WINDOWS 16
+#define DEIMOS_MAX_WORKSPACES 4
 
 #define DEIMOS_SPLIT_TARGET_MOUSE 0
 #define DEIMOS_SPLIT_TARGET_FOCUS 1
 
+#define DEIMOS_SPLIT_RATIO_DEFAULT 500 // permille of the parent given to the left/top half
+#define DEIMOS_SPLIT_RATIO_MIN 50
+#define DEIMOS_SPLIT_RATIO_MAX 950
+
+#define DEIMOS_SPLIT_ORIENT_AUTO 0
+#define DEIMOS_SPLIT_ORIENT_VERTICAL 1
+#define DEIMOS_SPLIT_ORIENT_HORIZONTAL 2
+
 void deimos_wm_init(int default_x, int default_y);
 int deimos_wm_window_count(void);
+// Workspaces: every call below acts on the active one. Switching bumps the
+// stacking serial so the compositor re-derives its draw order.
+int deimos_wm_workspace(void);
+int deimos_wm_switch_workspace(int workspace);
 void deimos_wm_add_window_split(int x, int y, int target_mode);
 int deimos_wm_set_focus_window_id(int window_id);
 int deimos_wm_set_split_for_window_id(int window_id, int x, int y);
+int deimos_wm_set_split_ratio(int index, int permille);
+// Freezes a split's resolved tree position (target, orientation, which half the
+// new window took) so changing ratios cannot reshuffle the BSP.
+void deimos_wm_pin_split(int index, int target_id, int orient, int side);
+
+// Floating layer. Floating windows leave the BSP and are stacked above tiles
+// in z order; focusing a floating window raises it.
+int deimos_wm_toggle_floating(int window_id, int x, int y, int w, int h);
+int deimos_wm_set_float_position(int window_id, int x, int y);
+int deimos_wm_raise_window(int window_id);
+int deimos_wm_is_floating(int window_id);
+int deimos_wm_z_count(void);
+int deimos_wm_z_window_id(int slot); // bottom to top
+int deimos_wm_stacking_serial(void);
 
-// Exposed for compositor.mtc extern calls.
+// Split table accessors, mirrored into the compositor shared state block.
 int deimos_split_x(int index);
 int deimos_split_y(int index);
 int deimos_split_target_mode(int index);
 int deimos_split_target_id(int index);
+int deimos_split_ratio(int index);
+int deimos_split_orient(int index);
+int deimos_split_side(int index);
+int deimos_split_pinned_target_id(int index);
+int deimos_window_floating(int index);
+int deimos_float_x(int index);
+int deimos_float_y(int index);
+int deimos_float_w(int index);
+int deimos_float_h(int index);
 int deimos_focus_window_id(void);
 
 #endif